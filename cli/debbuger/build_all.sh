@@ -20,24 +20,17 @@ mkdir -p "$OUT_DIR"
 
 for ecc_file in "$SRC_DIR"/*.ec; do
     echo "Compiling $ecc_file → $OUT_DIR"
-    ./ecc "$ecc_file" -o "$OUT_DIR"
+    ./ecc "$ecc_file" --emit=exe --link-arg=-fsanitize=address -o "$OUT_DIR"
 done
-echo "=== All .ec compiled to LLVM IR ==="
+echo "=== All .ec compiled to executables ==="
 
 
-for ll_file in "$OUT_DIR"/*.ll; do
-    base=$(basename "$ll_file" .ll)
-    obj_file="$OUT_DIR/$base.o"
+for ecc_file in "$SRC_DIR"/*.ec; do
+    base=$(basename "$ecc_file" .ec)
     exe_file="$OUT_DIR/$base"
 
-    echo "---- Building and running $ll_file ----"
-
-    
-    llc -filetype=obj "$ll_file" -o "$obj_file"
-
-    clang "$obj_file" -fsanitize=address -o "$exe_file"
+    echo "---- Running $exe_file ----"
 
-    echo "Running $exe_file"
     "$exe_file"
 
     echo "----------------------------"
@@ -1,9 +1,17 @@
 #include "../../src/lexer/lexer.h"
+#include "../../src/lexer/source.h"
 #include "../../src/parser/parser.h"
 #include "../../src/ast/printer.h"
+#include "../../src/ast/serialize.h"
 #include "../../src/codegen/codegen.h"
+#include "../../src/module/build_cache.h"
+#include "../../src/module/compiler_id.h"
 #include "../../src/module/resolver.h"
+#include "../../src/module/thread_pool.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -20,15 +28,41 @@ static void print_help(const char *exec)
               << exec << " [options] <file.ec | dir>\n"
                          "  "
               << exec << " [options] <file1.ec file2.ec ...>\n"
+                         "  "
+              << exec << " [options] <file.ec ...> <lib.bc ...>\n"
+                         "  "
+              << exec << " run [options] <file.ec> [args...]\n"
                          "\n"
                          "Modes:\n"
                          "  ll                Emit LLVM IR only\n"
                          "  debug             Show tokens, AST, and LLVM IR\n"
+                         "  ast               Print the AST of each file\n"
                          "  build             Build project from ecpl.json\n"
+                         "  run               JIT-compile and run in-process; args after the file go to the program\n"
                          "  help              Show this help\n"
                          "\n"
                          "Options:\n"
                          "  -o <dir>          Output directory (default: current directory)\n"
+                         "  -j <n>            Parse up to n files in parallel (default: all cores)\n"
+                         "  -O0 -O1 -O2 -O3   Optimization level (default: -O0)\n"
+                         "  -Os -Oz           Optimize for size\n"
+                         "  --time            Print a per-phase compile report\n"
+                         "  --emit=<kind>     ll (default), bc, asm, obj or exe\n"
+                         "  --link-arg=<arg>  Pass <arg> to the linker with --emit=exe\n"
+                         "  --target=<triple> Target triple (default: host)\n"
+                         "  --cpu=<name>      Target CPU; \"native\" uses the host CPU and its features\n"
+                         "  --features=<list> Extra target features, e.g. +avx2,-fma\n"
+                         "  --split           With build: one compilation unit per module, generated in parallel\n"
+                         "  --lto=thin        With build: split units plus ThinLTO cross-module optimization\n"
+                         "  --codegen-jobs=<n> Split the module and lower it to machine code on n threads;\n"
+                         "                    with --emit=exe, at most one per hardware thread\n"
+                         "  --tiered          With run: start at -O0, recompile hot functions at -O3 in the background\n"
+                         "  --no-cache        Skip the JIT object cache (run) and the build cache (build)\n"
+                         "  --reload          With ast: print the tree after a save to and load from the\n"
+                         "                    binary AST format\n"
+                         "  --lazy-bodies     Parse function bodies only when code is generated for them;\n"
+                         "                    private functions that main and pub functions cannot reach\n"
+                         "                    are never parsed\n"
                          "\n"
                          "Examples:\n"
                          "  "
@@ -38,10 +72,17 @@ static void print_help(const char *exec)
                          "  "
               << exec << " build              # Uses ecpl.json\n"
                          "  "
-              << exec << " ll main.ec\n";
+              << exec << " ll main.ec\n"
+                         "  "
+              << exec << " --emit=exe -O2 main.ec\n"
+                         "  "
+              << exec << " run -O2 main.ec arg1 arg2\n";
 }
 
-static std::vector<fs::path> collect_sources(const std::vector<std::string> &inputs)
+// .bc inputs are precompiled modules; they are linked into the generated
+// module instead of being parsed.
+static std::vector<fs::path> collect_sources(const std::vector<std::string> &inputs,
+                                             std::vector<fs::path> &bitcode)
 {
     std::vector<fs::path> result;
     for (auto &arg : inputs)
@@ -59,6 +100,8 @@ static std::vector<fs::path> collect_sources(const std::vector<std::string> &inp
         {
             if (p.extension() == ".ec")
                 result.push_back(p);
+            else if (p.extension() == ".bc")
+                bitcode.push_back(p);
         }
         else
         {
@@ -68,53 +111,102 @@ static std::vector<fs::path> collect_sources(const std::vector<std::string> &inp
     return result;
 }
 
+struct ParsedSource
+{
+    std::unique_ptr<ast::Program> program;
+    std::string diagnostics;
+};
+
+// Runs on a worker thread: everything it reports goes into the result so
+// diagnostics come out grouped by file and in input order.
+static ParsedSource parse_source(const fs::path &p, bool lazy_bodies)
+{
+    ParsedSource out;
+    std::ostringstream diag;
+
+    auto source = lex::SourceBuffer::open(p);
+    if (!source)
+    {
+        diag << "Failed to open: " << p << "\n";
+        out.diagnostics = diag.str();
+        return out;
+    }
+
+    // The parser recovers and always returns a program, so a file has
+    // failed when anything was reported for it.
+    size_t errors = 0;
+    auto lex_err = [&p, &diag, &errors](int line, int col, const std::string &msg)
+    {
+        ++errors;
+        diag << "[lexer error] " << p << ":" << line << ":" << col << " " << msg << "\n";
+    };
+    auto parse_err = [&p, &diag, &errors](int line, int col, const std::string &msg)
+    {
+        ++errors;
+        diag << "[parser error] " << p << ":" << line << ":" << col << " " << msg << "\n";
+    };
+
+    lex::Lexer lx(source->view(), lex_err);
+    path::Parser parser(lx, parse_err);
+    if (lazy_bodies)
+    {
+        parser.set_lazy_bodies(source, [p](int line, int col, const std::string &msg)
+                               {
+            std::ostringstream os;
+            os << "[parser error] " << p << ":" << line << ":" << col << " " << msg;
+            return os.str(); });
+    }
+    out.program = parser.parse_program();
+    if (errors)
+    {
+        out.program.reset();
+        diag << "Parsing failed for " << p << "\n";
+    }
+
+    out.diagnostics = diag.str();
+    return out;
+}
+
 static std::unique_ptr<ast::Program> compile_frontend_simple(
     const std::vector<fs::path> &sources,
+    unsigned jobs,
+    bool lazy_bodies,
     bool debug_ast = false)
 {
     std::unique_ptr<ast::Program> merged = std::make_unique<ast::Program>();
-    std::vector<std::unique_ptr<ast::Decl>> struct_decls;
-    std::vector<std::unique_ptr<ast::Decl>> other_decls;
+    std::vector<ast::Ptr<ast::Decl>> struct_decls;
+    std::vector<ast::Ptr<ast::Decl>> other_decls;
 
-    for (const auto &p : sources)
-    {
-        std::ifstream in(p);
-        if (!in)
-        {
-            std::cerr << "Failed to open: " << p << "\n";
-            return nullptr;
-        }
-        std::stringstream buf;
-        buf << in.rdbuf();
-        std::string source = buf.str();
+    std::vector<ParsedSource> parsed(sources.size());
+    module::ThreadPool pool(std::min<size_t>(jobs, sources.size()));
+    pool.run(sources.size(), [&](size_t i)
+             { parsed[i] = parse_source(sources[i], lazy_bodies); });
 
-        auto lex_err = [&p](int line, int col, const std::string &msg)
-        {
-            std::cerr << "[lexer error] " << p << ":" << line << ":" << col << " " << msg << "\n";
-        };
-        auto parse_err = [&p](int line, int col, const std::string &msg)
-        {
-            std::cerr << "[parser error] " << p << ":" << line << ":" << col << " " << msg << "\n";
-        };
-
-        lex::Lexer lx(source, lex_err);
-        path::Parser parser(lx, parse_err);
-        auto file_prog = parser.parse_program();
-        if (!file_prog)
-        {
-            std::cerr << "Parsing failed for " << p << "\n";
-            return nullptr;
-        }
+    // Every file's diagnostics are printed before giving up on the first
+    // one that failed.
+    bool failed = false;
+    for (auto &ps : parsed)
+    {
+        std::cerr << ps.diagnostics;
+        if (!ps.program)
+            failed = true;
+        if (failed)
+            continue;
 
+        auto &file_prog = ps.program;
+        merged->adopt(*file_prog);
         for (auto &d : file_prog->decls)
         {
-            if (dynamic_cast<ast::StructDecl *>(d.get()))
+            if (d->kind == ast::NodeKind::StructDecl)
                 struct_decls.push_back(std::move(d));
             else
                 other_decls.push_back(std::move(d));
         }
     }
 
+    if (failed)
+        return nullptr;
+
     for (auto &sd : struct_decls)
         merged->decls.push_back(std::move(sd));
     for (auto &od : other_decls)
@@ -129,6 +221,254 @@ static std::unique_ptr<ast::Program> compile_frontend_simple(
     return merged;
 }
 
+enum class EmitKind
+{
+    IR,
+    Bitcode,
+    Asm,
+    Obj,
+    Exe,
+};
+
+static bool parse_emit_kind(const std::string &val, EmitKind &kind)
+{
+    if (val == "ll")
+        kind = EmitKind::IR;
+    else if (val == "bc")
+        kind = EmitKind::Bitcode;
+    else if (val == "asm")
+        kind = EmitKind::Asm;
+    else if (val == "obj")
+        kind = EmitKind::Obj;
+    else if (val == "exe")
+        kind = EmitKind::Exe;
+    else
+        return false;
+    return true;
+}
+
+static bool parse_opt_level(const std::string &arg, codegen::OptLevel &level)
+{
+    static const std::pair<const char *, codegen::OptLevel> levels[] = {
+        {"-O0", codegen::OptLevel::O0},
+        {"-O1", codegen::OptLevel::O1},
+        {"-O2", codegen::OptLevel::O2},
+        {"-O3", codegen::OptLevel::O3},
+        {"-Os", codegen::OptLevel::Os},
+        {"-Oz", codegen::OptLevel::Oz},
+    };
+    for (const auto &[name, lvl] : levels)
+    {
+        if (arg == name)
+        {
+            level = lvl;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Wall-clock time per compile phase, printed with --time.
+class CompileReport
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    void start() { last_ = clock::now(); }
+
+    void phase(const std::string &name)
+    {
+        auto now = clock::now();
+        phases_.emplace_back(name, std::chrono::duration<double, std::milli>(now - last_).count());
+        last_ = now;
+    }
+
+    void output(const fs::path &file)
+    {
+        std::error_code ec;
+        output_bytes_ = fs::file_size(file, ec);
+        if (ec)
+            output_bytes_ = 0;
+    }
+
+    void print() const
+    {
+        double total = 0;
+        std::cerr << "--- compile report ---\n";
+        for (const auto &[name, ms] : phases_)
+        {
+            char line[64];
+            std::snprintf(line, sizeof(line), "  %-12s %10.2f ms\n", name.c_str(), ms);
+            std::cerr << line;
+            total += ms;
+        }
+        char line[64];
+        std::snprintf(line, sizeof(line), "  %-12s %10.2f ms\n", "total", total);
+        std::cerr << line;
+        if (output_bytes_)
+        {
+            std::snprintf(line, sizeof(line), "  %-12s %10llu bytes\n", "output", static_cast<unsigned long long>(output_bytes_));
+            std::cerr << line;
+        }
+    }
+
+private:
+    clock::time_point last_;
+    std::vector<std::pair<std::string, double>> phases_;
+    uintmax_t output_bytes_ = 0;
+};
+
+// `ecc ast`: prints each file's tree as parsed or, with --reload, after a
+// round trip through the binary AST format, so diffing the two checks the
+// format. With --time the report sets parsing against loading.
+static bool print_ast_files(const std::vector<std::string> &inputs, bool reload, CompileReport &report)
+{
+    std::vector<fs::path> bitcode;
+    auto sources = collect_sources(inputs, bitcode);
+    report.start();
+
+    bool ok = !sources.empty();
+    std::vector<std::unique_ptr<ast::Program>> programs;
+    for (const auto &src : sources)
+    {
+        auto parsed = parse_source(src, false);
+        std::cerr << parsed.diagnostics;
+        ok = ok && parsed.program;
+        programs.push_back(std::move(parsed.program));
+    }
+    report.phase("lex+parse");
+    if (!ok)
+        return false;
+
+    if (reload)
+    {
+        std::vector<std::string> data;
+        for (const auto &program : programs)
+            data.push_back(ast::write_binary(*program));
+        report.phase("write");
+        for (size_t i = 0; i < programs.size(); ++i)
+        {
+            programs[i] = ast::read_binary(data[i]);
+            if (!programs[i])
+            {
+                std::cerr << "Failed to reload the binary AST of " << sources[i] << "\n";
+                return false;
+            }
+        }
+        report.phase("load");
+    }
+
+    for (const auto &program : programs)
+        print_ast(*program);
+    return true;
+}
+
+// Bodies skipped by --lazy-bodies are parsed while code is generated, on
+// whichever thread reaches them. Their errors wait on the program and are
+// printed here, once codegen is done, grouped by file.
+static bool report_late_errors(ast::Program &program)
+{
+    auto errors = program.take_late_errors();
+    for (const auto &msg : errors)
+        std::cerr << msg << "\n";
+    if (!errors.empty())
+        std::cerr << "Parsing failed\n";
+    return errors.empty();
+}
+
+// Generates every unit on its own CodeGen, up to `jobs` at a time. Units
+// headed for native code are optimized here too, since they are never merged;
+// for ThinLTO that is only the pre-link pipeline.
+static std::vector<std::unique_ptr<codegen::CodeGen>> generate_units(std::vector<module::ModuleUnit> &units,
+                                                                      unsigned jobs,
+                                                                      const codegen::TargetConfig *target,
+                                                                      codegen::OptLevel opt_level,
+                                                                      bool thin_prelink,
+                                                                      const std::vector<char> &skip = {})
+{
+    std::vector<std::unique_ptr<codegen::CodeGen>> cgs(units.size());
+    std::vector<char> ok(units.size(), 0);
+
+    module::ThreadPool pool(std::min<size_t>(jobs, units.size()));
+    pool.run(units.size(), [&](size_t i)
+             {
+        const module::ModuleUnit &unit = units[i];
+        if (i < skip.size() && skip[i])
+        {
+            ok[i] = 1;
+            return;
+        }
+        auto cg = std::make_unique<codegen::CodeGen>(unit.module_name);
+        if (target && !cg->set_target(*target))
+            return;
+        cg->set_symbol_prefix(unit.module_name + ".");
+        if (!cg->generate(*unit.program, unit.externs))
+            return;
+        cg->optimize(opt_level, thin_prelink);
+        cgs[i] = std::move(cg);
+        ok[i] = 1; });
+
+    bool parsed = true;
+    for (auto &unit : units)
+        parsed = report_late_errors(*unit.program) && parsed;
+    if (!parsed)
+        return {};
+
+    for (size_t i = 0; i < units.size(); ++i)
+    {
+        if (!ok[i])
+        {
+            std::cerr << "codegen failed in module " << units[i].module_name << "\n";
+            return {};
+        }
+    }
+    return cgs;
+}
+
+// One output per backend partition: <stem>.<ext>, or <stem>.<i>.<ext> when
+// the module is split.
+static std::vector<std::string> partition_paths(const fs::path &stem, unsigned parts, const std::string &ext)
+{
+    if (parts <= 1)
+        return {stem.string() + ext};
+    std::vector<std::string> paths;
+    for (unsigned i = 0; i < parts; ++i)
+        paths.push_back(stem.string() + "." + std::to_string(i) + ext);
+    return paths;
+}
+
+// Folded into the JIT cache key, so neither a rebuilt compiler nor an
+// edited input hits a stale entry.
+static std::string jit_cache_salt(const std::vector<fs::path> &files)
+{
+    std::string salt = module::compiler_id();
+    for (const auto &f : files)
+        salt += "\n" + f.string() + " " + module::BuildCache::hash_file(f);
+    return module::BuildCache::hash(salt);
+}
+
+// Everything besides the sources that changes what a build writes: the
+// compiler build and the options that reach the output. -j, --time and
+// --no-cache only change how a build runs, so they keep the cache. The
+// codegen job count decides how many objects --emit=obj writes, and
+// --lazy-bodies drops unreferenced private functions, so both count.
+static std::string build_stamp(const std::string &opt_name, EmitKind emit_kind, const codegen::TargetConfig &target,
+                               const std::vector<std::string> &link_args, bool thin_lto, bool split,
+                               unsigned codegen_jobs, bool lazy_bodies)
+{
+    std::string stamp = module::compiler_id();
+    stamp += "\n" + opt_name;
+    stamp += "\nemit " + std::to_string(static_cast<int>(emit_kind));
+    stamp += "\ntarget " + target.triple + " " + target.cpu + " " + target.features;
+    stamp += thin_lto ? "\nlto thin" : "\nlto none";
+    stamp += split ? "\nsplit" : "\nwhole";
+    stamp += "\ncodegen-jobs " + std::to_string(codegen_jobs);
+    stamp += lazy_bodies ? "\nlazy-bodies" : "\neager-bodies";
+    for (const auto &arg : link_args)
+        stamp += "\nlink-arg " + arg;
+    return stamp;
+}
+
 static fs::path find_ecpl_json()
 {
     fs::path cwd = fs::current_path();
@@ -165,7 +505,25 @@ int main(int argc, char *argv[])
     std::string mode = argv[1];
     bool emit_ir_only = false;
     bool debug = false;
+    bool ast_mode = false;
+    bool reload_ast = false;
     bool use_project_mode = false;
+    bool run_mode = false;
+    bool tiered = false;
+    bool use_cache = true;
+    bool lazy_bodies = false;
+    std::vector<std::string> program_args;
+    bool split = false;
+    bool thin_lto = false;
+    unsigned codegen_jobs = 1;
+    unsigned jobs = module::ThreadPool::default_jobs();
+    codegen::OptLevel opt_level = codegen::OptLevel::O0;
+    std::string opt_name = "-O0";
+    bool time_report = false;
+    EmitKind emit_kind = EmitKind::IR;
+    std::vector<std::string> link_args;
+    codegen::TargetConfig target;
+    bool custom_target = false;
     fs::path output_dir = ".";
 
     std::vector<std::string> inputs;
@@ -183,6 +541,103 @@ int main(int argc, char *argv[])
             output_dir = argv[i + 1];
             i++;
         }
+        else if (arg.rfind("-j", 0) == 0)
+        {
+            std::string val = arg.size() > 2 ? arg.substr(2) : "";
+            if (val.empty())
+            {
+                if (i + 1 >= argc)
+                {
+                    std::cerr << arg << " requires a job count\n";
+                    return 1;
+                }
+                val = argv[++i];
+            }
+            try
+            {
+                int n = std::stoi(val);
+                jobs = n > 0 ? static_cast<unsigned>(n) : 1;
+            }
+            catch (const std::exception &)
+            {
+                std::cerr << "invalid job count: " << val << "\n";
+                return 1;
+            }
+        }
+        else if (parse_opt_level(arg, opt_level))
+        {
+            opt_name = arg;
+        }
+        else if (arg == "--time")
+        {
+            time_report = true;
+        }
+        else if (arg == "--tiered")
+        {
+            tiered = true;
+        }
+        else if (arg == "--no-cache")
+        {
+            use_cache = false;
+        }
+        else if (arg == "--lazy-bodies")
+        {
+            lazy_bodies = true;
+        }
+        else if (arg == "--split")
+        {
+            split = true;
+        }
+        else if (arg.rfind("--codegen-jobs=", 0) == 0)
+        {
+            try
+            {
+                int n = std::stoi(arg.substr(15));
+                codegen_jobs = n > 0 ? static_cast<unsigned>(n) : 1;
+            }
+            catch (const std::exception &)
+            {
+                std::cerr << "invalid codegen job count: " << arg.substr(15) << "\n";
+                return 1;
+            }
+        }
+        else if (arg.rfind("--lto=", 0) == 0)
+        {
+            if (arg.substr(6) != "thin")
+            {
+                std::cerr << "unknown --lto mode: " << arg.substr(6) << " (expected thin)\n";
+                return 1;
+            }
+            thin_lto = true;
+            split = true;
+        }
+        else if (arg.rfind("--emit=", 0) == 0)
+        {
+            if (!parse_emit_kind(arg.substr(7), emit_kind))
+            {
+                std::cerr << "unknown --emit kind: " << arg.substr(7) << " (expected ll, bc, asm, obj or exe)\n";
+                return 1;
+            }
+        }
+        else if (arg.rfind("--link-arg=", 0) == 0)
+        {
+            link_args.push_back(arg.substr(11));
+        }
+        else if (arg.rfind("--target=", 0) == 0)
+        {
+            target.triple = arg.substr(9);
+            custom_target = true;
+        }
+        else if (arg.rfind("--cpu=", 0) == 0)
+        {
+            target.cpu = arg.substr(6);
+            custom_target = true;
+        }
+        else if (arg.rfind("--features=", 0) == 0)
+        {
+            target.features = arg.substr(11);
+            custom_target = true;
+        }
         else if (arg == "help")
         {
             print_help(argv[0]);
@@ -196,23 +651,63 @@ int main(int argc, char *argv[])
         {
             debug = true;
         }
+        else if (arg == "ast")
+        {
+            ast_mode = true;
+        }
+        else if (arg == "--reload")
+        {
+            reload_ast = true;
+        }
         else if (arg == "build")
         {
             use_project_mode = true;
         }
+        else if (arg == "run" && inputs.empty())
+        {
+            run_mode = true;
+        }
         else
         {
             inputs.push_back(arg);
+            if (run_mode)
+            {
+                program_args.assign(argv + i + 1, argv + argc);
+                break;
+            }
         }
     }
 
+    if (thin_lto && (!use_project_mode || (emit_kind != EmitKind::Obj && emit_kind != EmitKind::Exe)))
+    {
+        std::cerr << "--lto=thin needs build mode and --emit=obj or --emit=exe\n";
+        return 1;
+    }
+
     if (!fs::exists(output_dir))
     {
         fs::create_directories(output_dir);
     }
 
+    CompileReport report;
+    report.start();
+
+    if (ast_mode)
+    {
+        bool ok = print_ast_files(inputs, reload_ast, report);
+        if (time_report)
+            report.print();
+        return ok ? 0 : 1;
+    }
+
     std::unique_ptr<ast::Program> program;
+    std::vector<module::ModuleUnit> units;
+    std::unique_ptr<module::BuildCache> build_cache;
+    std::vector<std::string> unit_keys;
+    std::vector<fs::path> outputs;
+    std::string project_name;
     std::vector<fs::path> src_files;
+    std::vector<fs::path> bc_files;
 
     if (use_project_mode)
     {
@@ -238,6 +733,8 @@ int main(int argc, char *argv[])
         
         module::ModuleResolver resolver;
         resolver.set_project_root(project_root);
+        resolver.set_jobs(jobs);
+        resolver.set_lazy_bodies(lazy_bodies);
         
         for (const auto &src_dir : config->src_dirs)
         {
@@ -266,14 +763,81 @@ int main(int argc, char *argv[])
 
         std::cout << "Found " << sources.size() << " source file(s)\n";
 
+        // Printing modes always run, since their output is the point.
+        if (use_cache && !run_mode && !emit_ir_only && !debug)
+        {
+            build_cache = std::make_unique<module::BuildCache>(project_root / config->output_dir / ".ecpl-build",
+                                                               build_stamp(opt_name, emit_kind, target, link_args, thin_lto,
+                                                                           split, codegen_jobs, lazy_bodies));
+            build_cache->scan(sources);
+            report.phase("hash");
+            if (build_cache->up_to_date())
+            {
+                std::cout << "Up to date (" << build_cache->hits() << " hit(s), 0 miss(es))\n";
+                if (time_report)
+                    report.print();
+                return 0;
+            }
+        }
+
+        if (build_cache)
+        {
+            // Only split native builds can take a module's code from a cached
+            // object, so only they may leave a module unparsed.
+            bool native = emit_kind == EmitKind::Obj || emit_kind == EmitKind::Exe;
+            fs::path cache_dir = project_root / config->output_dir / ".ecpl-build";
+            resolver.set_ast_cache(cache_dir / "ast");
+            resolver.set_interface_cache(cache_dir / "iface", split && native && !thin_lto);
+        }
         if (!resolver.resolve_all(sources))
         {
             std::cerr << "Module resolution failed\n";
             return 1;
         }
+        if (build_cache)
+        {
+            std::vector<fs::path> files;
+            for (const auto &entry : resolver.get_modules())
+                files.push_back(entry.second.file_path);
+            build_cache->set_files(files);
+        }
+
+        if (split)
+        {
+            // A module needs its body only when its object is not cached.
+            std::unordered_map<std::string, std::string> keys;
+            if (build_cache)
+            {
+                for (const auto &entry : resolver.get_modules())
+                {
+                    std::vector<std::string> interfaces;
+                    for (const auto &dep : resolver.unit_inputs(entry.first))
+                        interfaces.push_back(resolver.get_modules().at(dep).interface_hash);
+                    keys[entry.first] = build_cache->module_key(entry.second.file_path, std::move(interfaces));
+                }
+                for (const auto &[name, key] : keys)
+                {
+                    if (!build_cache->find_object(key) && !resolver.load_body(name))
+                    {
+                        std::cerr << "Module resolution failed\n";
+                        return 1;
+                    }
+                }
+            }
+            units = resolver.link_units();
+            if (build_cache)
+            {
+                for (const auto &unit : units)
+                    unit_keys.push_back(keys[unit.module_name]);
+            }
+        }
+        else
+            program = resolver.link_program();
+        if (resolver.ast_cache_hits() || resolver.summary_modules())
+            std::cout << "Loaded " << resolver.ast_cache_hits() << " unchanged module(s) without parsing, "
+                      << resolver.summary_modules() << " from interfaces only\n";
+        project_name = config->name;
 
-        program = resolver.link_program();
-        
         output_dir = project_root / config->output_dir;
         if (!fs::exists(output_dir))
         {
@@ -290,24 +854,185 @@ int main(int argc, char *argv[])
             return 1;
         }
 
-        src_files = collect_sources(inputs);
-        if (src_files.empty())
+        src_files = collect_sources(inputs, bc_files);
+        if (src_files.empty() && bc_files.empty())
         {
-            std::cerr << "No .ec source files found.\n";
+            std::cerr << "No .ec or .bc input files found.\n";
             return 1;
         }
 
-        program = compile_frontend_simple(src_files, debug);
+        program = compile_frontend_simple(src_files, jobs, lazy_bodies, debug);
     }
 
-    if (!program)
+    if (!program && units.empty())
         return 1;
+    report.phase("frontend");
 
-    codegen::CodeGen cg("ec");
-    if (!cg.generate(*program))
+    auto save_build_cache = [&]()
     {
-        std::cerr << "codegen failed\n";
-        return 1;
+        if (!build_cache)
+            return;
+        build_cache->set_outputs(outputs);
+        build_cache->save();
+        std::cout << "Build cache: " << build_cache->hits() << " hit(s), " << build_cache->misses() << " miss(es)\n";
+    };
+
+    std::vector<std::unique_ptr<codegen::CodeGen>> cgs;
+    if (!units.empty())
+    {
+        bool native = emit_kind == EmitKind::Obj || emit_kind == EmitKind::Exe;
+
+        // Split native builds reuse the object of every module whose key
+        // is cached. ThinLTO objects depend on all modules at once.
+        std::vector<fs::path> cached(units.size());
+        std::vector<char> skip(units.size(), 0);
+        if (build_cache && native && !thin_lto)
+        {
+            build_cache->reset_counts();
+            for (size_t i = 0; i < units.size(); ++i)
+            {
+                if (auto obj = build_cache->find_object(unit_keys[i]))
+                {
+                    cached[i] = *obj;
+                    skip[i] = 1;
+                    build_cache->count_hit();
+                }
+                else
+                {
+                    build_cache->count_miss();
+                }
+            }
+        }
+
+        cgs = generate_units(units, jobs, custom_target ? &target : nullptr,
+                             native ? opt_level : codegen::OptLevel::O0, thin_lto, skip);
+        if (cgs.empty())
+            return 1;
+        report.phase(native && opt_level != codegen::OptLevel::O0 ? "codegen+opt" : "codegen");
+
+        if (native)
+        {
+            std::vector<std::string> objects;
+            module::ThreadPool pool(std::min<size_t>(jobs, cgs.size()));
+            if (thin_lto)
+            {
+                std::vector<codegen::ThinModule> thin(cgs.size());
+                pool.run(cgs.size(), [&](size_t i)
+                         {
+                    thin[i].name = units[i].module_name;
+                    cgs[i]->write_thin_bitcode(thin[i].bitcode); });
+                cgs.clear();
+                report.phase("summaries");
+
+                std::string err;
+                if (!codegen::thin_link(thin, target, opt_level, jobs, output_dir.string(), objects, err))
+                {
+                    std::cerr << "thin link failed: " << err << "\n";
+                    return 1;
+                }
+                report.phase("thin link");
+            }
+            else
+            {
+                objects.resize(cgs.size());
+                std::vector<char> ok(cgs.size(), 0);
+                pool.run(cgs.size(), [&](size_t i)
+                         {
+                    objects[i] = (output_dir / (units[i].module_name + ".o")).string();
+                    if (skip[i])
+                    {
+                        std::error_code ec;
+                        fs::copy_file(cached[i], objects[i], fs::copy_options::overwrite_existing, ec);
+                        ok[i] = !ec;
+                        return;
+                    }
+                    ok[i] = cgs[i]->write_native_file(objects[i]);
+                    if (ok[i] && build_cache)
+                        build_cache->store_object(unit_keys[i], objects[i]); });
+                if (std::find(ok.begin(), ok.end(), 0) != ok.end())
+                {
+                    std::cerr << "code emission failed\n";
+                    return 1;
+                }
+                report.phase("emit");
+            }
+
+            if (emit_kind == EmitKind::Obj)
+            {
+                for (const auto &obj : objects)
+                {
+                    std::cout << "Wrote object to " << obj << "\n";
+                    outputs.push_back(obj);
+                }
+            }
+            else
+            {
+                fs::path exe = output_dir / project_name;
+                std::string err;
+                bool linked = codegen::link_executable(objects, exe.string(), link_args, err);
+                std::error_code ec;
+                for (const auto &obj : objects)
+                    fs::remove(obj, ec);
+                if (!linked)
+                {
+                    std::cerr << "link failed: " << err << "\n";
+                    return 1;
+                }
+                std::cout << "Wrote executable to " << exe << "\n";
+                report.phase("link");
+                report.output(exe);
+                outputs.push_back(exe);
+            }
+            save_build_cache();
+            if (time_report)
+                report.print();
+            return 0;
+        }
+
+        // Textual and bitcode output is a single file, so the units are
+        // linked back together and optimized as a whole.
+        for (size_t i = 1; i < cgs.size(); ++i)
+        {
+            if (!cgs.front()->link_module(*cgs[i]))
+                return 1;
+        }
+        cgs.resize(1);
+        report.phase("link units");
+    }
+    else
+    {
+        cgs.push_back(std::make_unique<codegen::CodeGen>("ec"));
+        cgs.front()->set_debug(debug);
+        if (custom_target && !cgs.front()->set_target(target))
+            return 1;
+        bool generated = cgs.front()->generate(*program);
+        if (!report_late_errors(*program))
+            return 1;
+        if (!generated)
+        {
+            std::cerr << "codegen failed\n";
+            return 1;
+        }
+        report.phase("codegen");
+    }
+    codegen::CodeGen &cg = *cgs.front();
+
+    if (!bc_files.empty())
+    {
+        for (const auto &bc : bc_files)
+        {
+            if (!cg.link_bitcode_file(bc.string()))
+                return 1;
+        }
+        report.phase("link bc");
+    }
+
+    // A tiered run starts from unoptimized code; the hot functions get -O3
+    // later.
+    if (opt_level != codegen::OptLevel::O0 && !(run_mode && tiered))
+    {
+        cg.optimize(opt_level);
+        report.phase("opt " + opt_name);
     }
 
     if (emit_ir_only || debug)
@@ -316,11 +1041,120 @@ int main(int argc, char *argv[])
         cg.dump_llvm_ir();
     }
 
-    fs::path base = src_files.size() == 1 ? src_files[0] : fs::path("merged");
-    fs::path out_file = output_dir / (base.stem().string() + ".ll");
+    if (run_mode)
+    {
+        // Objects live beside the project's output directory when there is
+        // an ecpl.json, otherwise under -o. Tiered runs are not cached.
+        bool cached = use_cache && !tiered;
+        if (cached)
+        {
+            fs::path config_path = find_ecpl_json();
+            fs::path root = config_path.empty() ? output_dir : config_path.parent_path();
+            std::vector<fs::path> inputs_to_hash = src_files;
+            inputs_to_hash.insert(inputs_to_hash.end(), bc_files.begin(), bc_files.end());
+            cg.set_jit_cache((root / ".ecpl-cache" / "jit").string(), jit_cache_salt(inputs_to_hash));
+        }
+        if (!cg.jit_compile(tiered))
+            return 1;
+        report.phase(!cached ? "jit" : cg.jit_cache_hit() ? "jit (warm)" : "jit (cold)");
+        // The report goes out before the program runs, so the startup
+        // latency is not mixed up with the program's own output.
+        if (time_report)
+            report.print();
+        int rc = cg.jit_run(program_args);
+        if (time_report && tiered)
+            std::cerr << "tiered: " << cg.jit_promoted() << " function(s) recompiled at -O3\n";
+        return rc;
+    }
+
+    fs::path base = "merged";
+    if (!units.empty())
+        base = project_name;
+    else if (src_files.size() == 1)
+        base = src_files[0];
+    else if (src_files.empty() && bc_files.size() == 1)
+        base = bc_files[0];
+    fs::path stem = output_dir / base.stem();
+
+    switch (emit_kind)
+    {
+    case EmitKind::IR:
+    {
+        fs::path out_file = stem.string() + ".ll";
+        if (!cg.write_ir_to_file(out_file.string()))
+            return 1;
+        std::cout << "Wrote IR to " << out_file << "\n";
+        report.phase("emit");
+        report.output(out_file);
+        outputs.push_back(out_file);
+        break;
+    }
+    case EmitKind::Bitcode:
+    {
+        fs::path out_file = stem.string() + ".bc";
+        if (!cg.write_bitcode_to_file(out_file.string()))
+            return 1;
+        std::cout << "Wrote bitcode to " << out_file << "\n";
+        report.phase("emit");
+        report.output(out_file);
+        outputs.push_back(out_file);
+        break;
+    }
+    case EmitKind::Asm:
+    case EmitKind::Obj:
+    {
+        bool assembly = emit_kind == EmitKind::Asm;
+        auto out_files = partition_paths(stem, codegen_jobs, assembly ? ".s" : ".o");
+        if (!cg.write_native_files(out_files, assembly))
+        {
+            std::cerr << "code emission failed\n";
+            return 1;
+        }
+        for (const auto &out_file : out_files)
+        {
+            std::cout << "Wrote " << (assembly ? "assembly" : "object") << " to " << out_file << "\n";
+            outputs.push_back(out_file);
+        }
+        report.phase("emit");
+        if (out_files.size() == 1)
+            report.output(out_files.front());
+        break;
+    }
+    case EmitKind::Exe:
+    {
+        // The partition objects are only linked, so there is no point in
+        // more of them than threads to lower them on: on one core the split
+        // costs 0-15% and gains nothing.
+        unsigned parts = std::min(codegen_jobs, module::ThreadPool::default_jobs());
+        auto obj_files = partition_paths(stem, parts, ".o");
+        if (!cg.write_native_files(obj_files))
+        {
+            std::cerr << "code emission failed\n";
+            return 1;
+        }
+        report.phase("emit");
+
+        std::string err;
+        bool linked = codegen::link_executable(obj_files, stem.string(), link_args, err);
+        std::error_code ec;
+        for (const auto &obj_file : obj_files)
+            fs::remove(obj_file, ec);
+        if (!linked)
+        {
+            std::cerr << "link failed: " << err << "\n";
+            return 1;
+        }
+        std::cout << "Wrote executable to " << stem << "\n";
+        report.phase("link");
+        report.output(stem);
+        outputs.push_back(stem);
+        break;
+    }
+    }
 
-    cg.write_ir_to_file(out_file.string());
-    std::cout << "Wrote IR to " << out_file << "\n";
+    save_build_cache();
+    if (time_report)
+        report.print();
 
     return 0;
 }
@@ -0,0 +1,24 @@
+# Writes OUTPUT, a translation unit defining module::compiler_id(): a hash
+# of every compiler source under SOURCE_DIR/src plus the LLVM version.
+# Build caches fold it into their keys, so any change to the compiler
+# invalidates what an older build wrote.
+
+file(GLOB_RECURSE sources LIST_DIRECTORIES false RELATIVE "${SOURCE_DIR}"
+    "${SOURCE_DIR}/src/*.h"
+    "${SOURCE_DIR}/src/*.cpp")
+list(SORT sources)
+
+set(inputs "llvm ${LLVM_VERSION}")
+foreach(source IN LISTS sources)
+    file(SHA1 "${SOURCE_DIR}/${source}" source_hash)
+    string(APPEND inputs "\n${source} ${source_hash}")
+endforeach()
+string(SHA1 id "${inputs}")
+
+file(WRITE "${OUTPUT}"
+"// Generated by cmake/compiler_id.cmake; do not edit.
+namespace module
+{
+    const char *compiler_id() { return \"ecc ${id} llvm ${LLVM_VERSION}\"; }
+}
+")
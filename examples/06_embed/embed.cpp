@@ -0,0 +1,74 @@
+// Compiles ECPL from memory through embed::Context and calls the result.
+// Built as ecc_embed_example; run_tests.sh runs it.
+
+#include "../../src/embed/embed.h"
+
+#include <cstdint>
+#include <iostream>
+
+static int failures = 0;
+
+static void check(bool ok, const std::string &what)
+{
+    std::cout << (ok ? "ok   " : "FAIL ") << what << "\n";
+    if (!ok)
+        ++failures;
+}
+
+int main()
+{
+    embed::Context ctx;
+
+    std::vector<embed::Diagnostic> diags;
+    auto program = ctx.compile({{"math.ec", "module math\n"
+                                            "\n"
+                                            "pub fn add(a i32, b i32) i32 {\n"
+                                            "    return a + b\n"
+                                            "}\n"
+                                            "\n"
+                                            "pub fn fact(n i32) i32 {\n"
+                                            "    r: i32 := 1\n"
+                                            "    for (i: i32 := 2; i <= n; i++) {\n"
+                                            "        r = r * i\n"
+                                            "    }\n"
+                                            "    return r\n"
+                                            "}\n"}},
+                               diags);
+    check(program && diags.empty(), "compile a module");
+    if (program)
+    {
+        auto add = program->function<int32_t(int32_t, int32_t)>("add");
+        auto fact = program->function<int32_t(int32_t)>("fact");
+        check(add && add(2, 40) == 42, "add(2, 40) == 42");
+        check(fact && fact(10) == 3628800, "fact(10) == 3628800");
+        check(!program->lookup("missing"), "lookup of an unknown name is null");
+    }
+
+    diags.clear();
+    auto broken = ctx.compile({{"broken.ec", "pub fn f() i32 {\n"
+                                             "    return )\n"
+                                             "}\n"}},
+                              diags);
+    check(!broken, "a syntax error fails the compile");
+    check(!diags.empty() && diags.front().file == "broken.ec" && diags.front().line == 2,
+          "the diagnostic names broken.ec line 2");
+    for (const auto &d : diags)
+        std::cout << "     " << d.file << ":" << d.line << ":" << d.col << " " << d.message << "\n";
+
+    diags.clear();
+    auto unresolved = ctx.compile({{"calls.ec", "pub fn g() i32 {\n"
+                                                "    return nope(1)\n"
+                                                "}\n"}},
+                                  diags);
+    check(!unresolved && !diags.empty(), "a codegen error fails the compile with a diagnostic");
+    for (const auto &d : diags)
+        std::cout << "     " << d.message << "\n";
+
+    diags.clear();
+    std::vector<char> object;
+    check(ctx.compile_object({{"obj.ec", "pub fn one() i32 {\n    return 1\n}\n"}}, object, diags) && !object.empty(),
+          "compile_object returns object bytes");
+
+    std::cout << (failures ? "embed: FAILED\n" : "embed: all checks passed\n");
+    return failures ? 1 : 0;
+}
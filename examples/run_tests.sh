@@ -3,6 +3,7 @@
 SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
 ROOT_DIR="$(dirname "$SCRIPT_DIR")"
 ECC="$ROOT_DIR/build/ecc"
+EMBED_EXAMPLE="$ROOT_DIR/build/ecc_embed_example"
 
 RED='\033[0;31m'
 GREEN='\033[0;32m'
@@ -25,9 +26,7 @@ compile_run_and_verify() {
     local expected_output="$2"
     local basename=$(basename "$ec_file" .ec)
     local out_dir="/tmp/ecpl_test_${basename}"
-    local ll_file="$out_dir/${basename}.ll"
-    local obj_file="$out_dir/${basename}.o"
-    local exe_file="$out_dir/${basename}_exe"
+    local exe_file="$out_dir/${basename}"
     
     rm -rf "$out_dir"
     mkdir -p "$out_dir"
@@ -35,7 +34,7 @@ compile_run_and_verify() {
     ((TOTAL++))
     printf "  ${BLUE}$basename${NC}... "
     
-    $ECC "$ec_file" -o "$out_dir" 2>&1 > "$out_dir/compile.log"
+    $ECC "$ec_file" --emit=exe -o "$out_dir" > "$out_dir/compile.log" 2>&1
     
     if grep -q "codegen error\|codegen failed" "$out_dir/compile.log"; then
         printf "${RED}FAIL${NC} (codegen error)\n"
@@ -44,24 +43,15 @@ compile_run_and_verify() {
         return 1
     fi
     
-    if [ ! -f "$ll_file" ]; then
-        printf "${RED}FAIL${NC} (no IR generated)\n"
-        ((FAIL++))
-        return 1
-    fi
-    
-    llc -filetype=obj "$ll_file" -o "$obj_file" 2>"$out_dir/llc.log"
-    if [ $? -ne 0 ]; then
-        printf "${RED}FAIL${NC} (llc error)\n"
-        cat "$out_dir/llc.log"
+    if grep -q "emission failed\|link failed" "$out_dir/compile.log"; then
+        printf "${RED}FAIL${NC} (link error)\n"
+        cat "$out_dir/compile.log"
         ((FAIL++))
         return 1
     fi
     
-    clang "$obj_file" -o "$exe_file" 2>"$out_dir/link.log"
-    if [ $? -ne 0 ]; then
-        printf "${RED}FAIL${NC} (link error)\n"
-        cat "$out_dir/link.log"
+    if [ ! -x "$exe_file" ]; then
+        printf "${RED}FAIL${NC} (no executable generated)\n"
         ((FAIL++))
         return 1
     fi
@@ -115,7 +105,7 @@ test_project() {
     
     rm -rf "$project_dir/build"
     
-    (cd "$project_dir" && $ECC build 2>&1) > "$out_dir/compile.log"
+    (cd "$project_dir" && $ECC build --emit=exe 2>&1) > "$out_dir/compile.log"
     
     if grep -q "codegen error\|codegen failed\|error\|failed" "$out_dir/compile.log"; then
         printf "${RED}FAIL${NC} (build error)\n"
@@ -124,28 +114,9 @@ test_project() {
         return 1
     fi
     
-    local ll_file=$(find "$project_dir/build" -name "*.ll" 2>/dev/null | head -1)
-    if [ -z "$ll_file" ]; then
-        printf "${RED}FAIL${NC} (no IR generated)\n"
-        ((FAIL++))
-        return 1
-    fi
-    
-    local obj_file="$out_dir/program.o"
-    local exe_file="$out_dir/program"
-    
-    llc -filetype=obj "$ll_file" -o "$obj_file" 2>"$out_dir/llc.log"
-    if [ $? -ne 0 ]; then
-        printf "${RED}FAIL${NC} (llc error)\n"
-        cat "$out_dir/llc.log"
-        ((FAIL++))
-        return 1
-    fi
-    
-    clang "$obj_file" -o "$exe_file" 2>"$out_dir/link.log"
-    if [ $? -ne 0 ]; then
-        printf "${RED}FAIL${NC} (link error)\n"
-        cat "$out_dir/link.log"
+    local exe_file=$(find "$project_dir/build" -maxdepth 1 -type f -perm -u+x 2>/dev/null | head -1)
+    if [ -z "$exe_file" ]; then
+        printf "${RED}FAIL${NC} (no executable generated)\n"
         ((FAIL++))
         return 1
     fi
@@ -200,6 +171,83 @@ echo "--- Project Tests ---"
 test_project "$SCRIPT_DIR/04_module_project" "30"
 test_project "$SCRIPT_DIR/05_multi_module" "Hello"
 
+run_embed_example() {
+    local out_dir="/tmp/ecpl_test_embed"
+
+    rm -rf "$out_dir"
+    mkdir -p "$out_dir"
+
+    ((TOTAL++))
+    printf "  ${BLUE}06_embed${NC}... "
+
+    if [ ! -x "$EMBED_EXAMPLE" ]; then
+        printf "${RED}FAIL${NC} (ecc_embed_example not built)\n"
+        ((FAIL++))
+        return 1
+    fi
+
+    if "$EMBED_EXAMPLE" > "$out_dir/run.log" 2>&1; then
+        printf "${GREEN}PASS${NC}\n"
+        ((PASS++))
+        return 0
+    else
+        printf "${RED}FAIL${NC}\n"
+        cat "$out_dir/run.log"
+        ((FAIL++))
+        return 1
+    fi
+}
+
+echo ""
+echo "--- Embedding API ---"
+run_embed_example
+
+# Prints an example's AST as parsed and again after a round trip through the
+# binary AST format; the two must be identical.
+test_ast_round_trip() {
+    local ec_file="$1"
+    local name="${ec_file#$SCRIPT_DIR/}"
+    local out_dir="/tmp/ecpl_test_ast/${name%.ec}"
+
+    rm -rf "$out_dir"
+    mkdir -p "$out_dir"
+
+    printf "  ${BLUE}$name${NC}... "
+
+    # Some examples use syntax the parser does not accept yet; there is no
+    # tree to round-trip.
+    if ! $ECC ast "$ec_file" > "$out_dir/parsed.txt" 2> "$out_dir/parsed.log"; then
+        printf "${YELLOW}SKIP${NC} (does not parse)\n"
+        return 0
+    fi
+
+    ((TOTAL++))
+
+    if ! $ECC ast --reload "$ec_file" > "$out_dir/reloaded.txt" 2> "$out_dir/reloaded.log"; then
+        printf "${RED}FAIL${NC} (reload error)\n"
+        cat "$out_dir/reloaded.log"
+        ((FAIL++))
+        return 1
+    fi
+
+    if diff -u "$out_dir/parsed.txt" "$out_dir/reloaded.txt" > "$out_dir/ast.diff"; then
+        printf "${GREEN}PASS${NC}\n"
+        ((PASS++))
+        return 0
+    else
+        printf "${RED}FAIL${NC} (AST differs after reload)\n"
+        head -20 "$out_dir/ast.diff"
+        ((FAIL++))
+        return 1
+    fi
+}
+
+echo ""
+echo "--- AST Round Trip ---"
+while IFS= read -r ec_file; do
+    test_ast_round_trip "$ec_file"
+done < <(find "$SCRIPT_DIR" -name "*.ec" | sort)
+
 echo ""
 echo "========================================"
 printf "  Results: ${GREEN}$PASS/$TOTAL passed${NC}\n"
@@ -0,0 +1,40 @@
+#include "arena.h"
+#include <cstdlib>
+
+namespace ast
+{
+    Arena::~Arena()
+    {
+        for (char *c : chunks_)
+            std::free(c);
+    }
+
+    void *Arena::allocate_slow(size_t size, size_t align)
+    {
+        // Oversized requests get a chunk of their own so the current one keeps
+        // serving small nodes.
+        size_t need = size + align;
+        if (need > chunk_size_ / 4)
+        {
+            char *big = static_cast<char *>(std::malloc(need));
+            if (!big)
+                throw std::bad_alloc();
+            chunks_.push_back(big);
+            reserved_ += need;
+            size_t p = (reinterpret_cast<size_t>(big) + align - 1) & ~(align - 1);
+            return reinterpret_cast<void *>(p);
+        }
+
+        char *chunk = static_cast<char *>(std::malloc(chunk_size_));
+        if (!chunk)
+            throw std::bad_alloc();
+        chunks_.push_back(chunk);
+        reserved_ += chunk_size_;
+        cur_ = chunk;
+        end_ = chunk + chunk_size_;
+
+        size_t p = (reinterpret_cast<size_t>(cur_) + align - 1) & ~(align - 1);
+        cur_ = reinterpret_cast<char *>(p + size);
+        return reinterpret_cast<void *>(p);
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ast
+{
+    // Bump allocator that owns every node of one parsed file. Nodes, their
+    // child lists and their names all live in large chunks, so building an
+    // AST costs a handful of mallocs and dropping it costs one free per chunk.
+    // Destructors are never run: anything placed here must keep its heap
+    // memory in the arena too (see List and Arena::str).
+    class Arena : public std::pmr::memory_resource
+    {
+    public:
+        static constexpr size_t default_chunk_size = 64 * 1024;
+
+        explicit Arena(size_t chunk_size = default_chunk_size) : chunk_size_(chunk_size) {}
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+        ~Arena() override;
+
+        void *allocate_bytes(size_t size, size_t align)
+        {
+            size_t p = (reinterpret_cast<size_t>(cur_) + align - 1) & ~(align - 1);
+            if (cur_ && p + size <= reinterpret_cast<size_t>(end_))
+            {
+                cur_ = reinterpret_cast<char *>(p + size);
+                return reinterpret_cast<void *>(p);
+            }
+            return allocate_slow(size, align);
+        }
+
+        template <typename T, typename... Args>
+        T *make(Args &&...args)
+        {
+            return new (allocate_bytes(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        // Copies `s` into the arena; the result stays valid as long as the arena.
+        std::string_view str(std::string_view s)
+        {
+            if (s.empty())
+                return {};
+            char *p = static_cast<char *>(allocate_bytes(s.size(), 1));
+            std::memcpy(p, s.data(), s.size());
+            return {p, s.size()};
+        }
+
+        size_t chunk_count() const { return chunks_.size(); }
+        size_t bytes_reserved() const { return reserved_; }
+
+    private:
+        std::vector<char *> chunks_;
+        char *cur_ = nullptr;
+        char *end_ = nullptr;
+        size_t chunk_size_;
+        size_t reserved_ = 0;
+
+        void *allocate_slow(size_t size, size_t align);
+
+        void *do_allocate(size_t size, size_t align) override { return allocate_bytes(size, align); }
+        void do_deallocate(void *, size_t, size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+    };
+
+    // Non-owning handle to an arena node. It keeps the unique_ptr surface the
+    // rest of the compiler was written against (get, ->, bool tests, upcasts)
+    // but is trivially copyable, since the arena decides the node's lifetime.
+    template <typename T>
+    class Ptr
+    {
+    public:
+        Ptr() = default;
+        Ptr(std::nullptr_t) {}
+        explicit Ptr(T *p) : p_(p) {}
+
+        template <typename U, typename = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+        Ptr(Ptr<U> other) : p_(other.get()) {}
+
+        T *get() const { return p_; }
+        T *operator->() const { return p_; }
+        T &operator*() const { return *p_; }
+        explicit operator bool() const { return p_ != nullptr; }
+
+        friend bool operator==(Ptr a, std::nullptr_t) { return a.p_ == nullptr; }
+        friend bool operator!=(Ptr a, std::nullptr_t) { return a.p_ != nullptr; }
+
+    private:
+        T *p_ = nullptr;
+    };
+
+    // Child lists draw their storage from the arena that owns the node.
+    template <typename T>
+    using List = std::pmr::vector<T>;
+}
@@ -398,11 +398,11 @@ namespace ast
             print_indent(os, indent + 2);
             os << "pub\n";
         }
-        if (body)
+        if (auto b = get_body())
         {
             print_indent(os, indent + 2);
             os << "body:\n";
-            body->print(os, indent + 4);
+            b->print(os, indent + 4);
         }
     }
 
@@ -1,22 +1,80 @@
 #pragma once
 #include "../lexer/token.h"
+#include "arena.h"
+#include "intern.h"
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <optional>
+#include <cstdint>
 
 namespace ast
 {
 
     using TokenType = lex::TokenType;
 
+    // One tag per concrete node type. Passes switch on Node::kind, or use
+    // ast::as<T>, instead of probing with dynamic_cast.
+    enum class NodeKind : uint8_t
+    {
+        NamedType,
+        PointerType,
+        ArrayType,
+        FuncType,
+
+        Ident,
+        Literal,
+        UnaryExpr,
+        BinaryExpr,
+        CallExpr,
+        ArrayLiteral,
+        ByteArrayLiteral,
+        MemberExpr,
+        IndexExpr,
+        PostfixExpr,
+        StructLiteral,
+
+        ExprStmt,
+        ReturnStmt,
+        VarDecl,
+        AssignStmt,
+        BlockStmt,
+        IfStmt,
+        ForInStmt,
+        ForStmt,
+        ForCStyleStmt,
+        BreakStmt,
+        ContinueStmt,
+
+        StructDecl,
+        PackageDecl,
+        ImportDecl,
+        FuncDecl,
+        StmtDecl,
+
+        Program,
+    };
+
     struct Node
     {
+        const NodeKind kind;
+        explicit Node(NodeKind k) : kind(k) {}
         virtual ~Node() = default;
         virtual void print(std::ostream &os, int indent = 0) const = 0;
     };
 
+    // Checked downcast on the node tag; nullptr when `n` is null or not a T.
+    // Constness follows the argument, like dynamic_cast.
+    template <typename T, typename N>
+    auto as(N *n) -> std::conditional_t<std::is_const_v<N>, const T *, T *>
+    {
+        using R = std::conditional_t<std::is_const_v<N>, const T *, T *>;
+        return n && n->kind == T::Kind ? static_cast<R>(n) : nullptr;
+    }
+
     inline void print_indent(std::ostream &os, int indent)
     {
         for (int i = 0; i < indent; ++i)
@@ -29,70 +87,81 @@ namespace ast
 
     struct Type : Node
     {
+        using Node::Node;
         virtual ~Type() = default;
     };
 
     struct NamedType : Type
     {
+        static constexpr NodeKind Kind = NodeKind::NamedType;
 
-        std::string name;
-        NamedType(const std::string &n) : name(n) {}
+        Symbol name;
+        NamedType(Symbol n) : Type(Kind), name(n) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct PointerType : Type
     {
-        std::unique_ptr<Type> base;
-        PointerType(std::unique_ptr<Type> b) : base(std::move(b)) {}
+        static constexpr NodeKind Kind = NodeKind::PointerType;
+
+        Ptr<Type> base;
+        PointerType(Ptr<Type> b) : Type(Kind), base(std::move(b)) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct ArrayType : Type
     {
-        std::unique_ptr<Type> elem;
+        static constexpr NodeKind Kind = NodeKind::ArrayType;
+
+        Ptr<Type> elem;
         bool is_slice = false;
         size_t size = 0;
 
-        ArrayType(std::unique_ptr<Type> e, bool slice, size_t sz = 0)
-            : elem(std::move(e)), is_slice(slice), size(sz) {}
+        ArrayType(Ptr<Type> e, bool slice, size_t sz = 0)
+            : Type(Kind), elem(std::move(e)), is_slice(slice), size(sz) {}
 
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct FuncType : Type
     {
-        std::vector<std::unique_ptr<Type>> params;
-        std::unique_ptr<Type> ret;
+        static constexpr NodeKind Kind = NodeKind::FuncType;
+
+        List<Ptr<Type>> params;
+        Ptr<Type> ret;
 
-        FuncType(std::vector<std::unique_ptr<Type>> p, std::unique_ptr<Type> r)
-            : params(std::move(p)), ret(std::move(r)) {}
+        FuncType(List<Ptr<Type>> p, Ptr<Type> r)
+            : Type(Kind), params(std::move(p)), ret(std::move(r)) {}
 
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct Decl : Node
     {
+        using Node::Node;
     };
 
     struct Expr : Node
     {
+        using Node::Node;
     };
 
     struct Stmt : Node
     {
+        using Node::Node;
     };
 
     struct StructField
     {
-        std::string name;
+        Symbol name;
 
-        std::unique_ptr<Type> type;
+        Ptr<Type> type;
 
-        std::shared_ptr<StructDecl> inline_struct;
+        Ptr<StructDecl> inline_struct;
         bool is_pub = false;
 
         StructField() = default;
-        StructField(const std::string &n, std::unique_ptr<Type> t)
+        StructField(Symbol n, Ptr<Type> t)
             : name(n), type(std::move(t)) {}
 
         void print(std::ostream &os, int indent = 0) const;
@@ -100,251 +169,290 @@ namespace ast
 
     struct StructDecl : Decl
     {
-        std::string name;
+        static constexpr NodeKind Kind = NodeKind::StructDecl;
 
-        std::vector<std::shared_ptr<StructField>> fields;
+        Symbol name;
 
-        std::vector<std::unique_ptr<Decl>> nested_decls;
+        List<Ptr<StructField>> fields;
+
+        List<Ptr<Decl>> nested_decls;
         bool is_pub = false;
 
-        StructDecl(const std::string &n = "") : name(n) {}
+        StructDecl(Symbol n, List<Ptr<StructField>> f)
+            : Decl(Kind), name(n), fields(std::move(f)), nested_decls(fields.get_allocator()) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct Ident : Expr
     {
-        std::string name;
-        Ident(const std::string &n) : name(n) {}
+        static constexpr NodeKind Kind = NodeKind::Ident;
+
+        Symbol name;
+        Ident(Symbol n) : Expr(Kind), name(n) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct Literal : Expr
     {
-        std::string raw;
+        static constexpr NodeKind Kind = NodeKind::Literal;
+
+        std::string_view raw;
         TokenType t;
-        Literal(const std::string &r, TokenType tt) : raw(r), t(tt) {}
+        Literal(std::string_view r, TokenType tt) : Expr(Kind), raw(r), t(tt) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct UnaryExpr : Expr
     {
-        std::string op;
-        std::unique_ptr<Expr> rhs;
-        UnaryExpr(const std::string &o, std::unique_ptr<Expr> r) : op(o), rhs(std::move(r)) {}
+        static constexpr NodeKind Kind = NodeKind::UnaryExpr;
+
+        std::string_view op;
+        Ptr<Expr> rhs;
+        UnaryExpr(std::string_view o, Ptr<Expr> r) : Expr(Kind), op(o), rhs(std::move(r)) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct BinaryExpr : Expr
     {
-        std::string op;
-        std::unique_ptr<Expr> left, right;
-        BinaryExpr(const std::string &o, std::unique_ptr<Expr> l, std::unique_ptr<Expr> r)
-            : op(o), left(std::move(l)), right(std::move(r)) {}
+        static constexpr NodeKind Kind = NodeKind::BinaryExpr;
+
+        std::string_view op;
+        Ptr<Expr> left, right;
+        BinaryExpr(std::string_view o, Ptr<Expr> l, Ptr<Expr> r)
+            : Expr(Kind), op(o), left(std::move(l)), right(std::move(r)) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct CallExpr : Expr
     {
-        std::unique_ptr<Expr> callee;
-        std::vector<std::unique_ptr<Expr>> args;
-        CallExpr(std::unique_ptr<Expr> c, std::vector<std::unique_ptr<Expr>> a)
-            : callee(std::move(c)), args(std::move(a)) {}
+        static constexpr NodeKind Kind = NodeKind::CallExpr;
+
+        Ptr<Expr> callee;
+        List<Ptr<Expr>> args;
+        CallExpr(Ptr<Expr> c, List<Ptr<Expr>> a)
+            : Expr(Kind), callee(std::move(c)), args(std::move(a)) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct ArrayLiteral : Expr
     {
+        static constexpr NodeKind Kind = NodeKind::ArrayLiteral;
 
-        std::unique_ptr<Type> array_type;
-        std::vector<std::unique_ptr<Expr>> elements;
+        Ptr<Type> array_type;
+        List<Ptr<Expr>> elements;
 
-        ArrayLiteral(std::vector<std::unique_ptr<Expr>> &&elems)
-            : array_type(nullptr), elements(std::move(elems)) {}
+        ArrayLiteral(List<Ptr<Expr>> &&elems)
+            : Expr(Kind), array_type(nullptr), elements(std::move(elems)) {}
 
-        ArrayLiteral(std::unique_ptr<Type> t, std::vector<std::unique_ptr<Expr>> &&elems)
-            : array_type(std::move(t)), elements(std::move(elems)) {}
+        ArrayLiteral(Ptr<Type> t, List<Ptr<Expr>> &&elems)
+            : Expr(Kind), array_type(std::move(t)), elements(std::move(elems)) {}
 
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct ByteArrayLiteral : Expr
     {
-        std::vector<std::unique_ptr<Expr>> elems;
+        static constexpr NodeKind Kind = NodeKind::ByteArrayLiteral;
 
-        ByteArrayLiteral(std::vector<std::unique_ptr<Expr>> &&e) : elems(std::move(e)) {}
+        List<Ptr<Expr>> elems;
 
-        ByteArrayLiteral(const std::vector<uint8_t> &bytes)
-        {
-            elems.reserve(bytes.size());
-            for (uint8_t b : bytes)
-            {
-                elems.emplace_back(
-                    std::make_unique<Literal>(std::to_string(static_cast<int>(b)), TokenType::INT));
-            }
-        }
+        ByteArrayLiteral(List<Ptr<Expr>> &&e) : Expr(Kind), elems(std::move(e)) {}
 
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct MemberExpr : Expr
     {
-        std::unique_ptr<Expr> object;
-        std::string member;
-        MemberExpr(std::unique_ptr<Expr> o, const std::string &m) : object(std::move(o)), member(m) {}
-        MemberExpr() : object(nullptr), member() {}
+        static constexpr NodeKind Kind = NodeKind::MemberExpr;
+
+        Ptr<Expr> object;
+        Symbol member;
+        MemberExpr(Ptr<Expr> o, Symbol m) : Expr(Kind), object(std::move(o)), member(m) {}
+        MemberExpr() : Expr(Kind), object(nullptr), member() {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct IndexExpr : Expr
     {
-        std::unique_ptr<Expr> collection;
-        std::unique_ptr<Expr> index;
+        static constexpr NodeKind Kind = NodeKind::IndexExpr;
+
+        Ptr<Expr> collection;
+        Ptr<Expr> index;
 
-        IndexExpr(std::unique_ptr<Expr> coll, std::unique_ptr<Expr> idx)
-            : collection(std::move(coll)), index(std::move(idx)) {}
+        IndexExpr(Ptr<Expr> coll, Ptr<Expr> idx)
+            : Expr(Kind), collection(std::move(coll)), index(std::move(idx)) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct PostfixExpr : Expr
     {
-        std::string op;
-        std::unique_ptr<Expr> lhs;
-        PostfixExpr(const std::string &op_, std::unique_ptr<Expr> lhs_)
-            : Expr(), op(op_), lhs(std::move(lhs_)) {}
+        static constexpr NodeKind Kind = NodeKind::PostfixExpr;
+
+        std::string_view op;
+        Ptr<Expr> lhs;
+        PostfixExpr(std::string_view op_, Ptr<Expr> lhs_)
+            : Expr(Kind), op(op_), lhs(std::move(lhs_)) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct StructFieldInit
     {
-        std::optional<std::string> name;
-        std::unique_ptr<Expr> value;
-        StructFieldInit(std::optional<std::string> n, std::unique_ptr<Expr> v) : name(n), value(std::move(v)) {}
+        std::optional<Symbol> name;
+        Ptr<Expr> value;
+        StructFieldInit(std::optional<Symbol> n, Ptr<Expr> v) : name(n), value(std::move(v)) {}
     };
 
     struct StructLiteral : Expr
     {
-        std::unique_ptr<Type> type;
-        std::vector<StructFieldInit> inits;
-        StructLiteral(std::unique_ptr<Type> t, std::vector<StructFieldInit> i) : type(std::move(t)), inits(std::move(i)) {}
+        static constexpr NodeKind Kind = NodeKind::StructLiteral;
+
+        Ptr<Type> type;
+        List<StructFieldInit> inits;
+        StructLiteral(Ptr<Type> t, List<StructFieldInit> i) : Expr(Kind), type(std::move(t)), inits(std::move(i)) {}
 
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct ExprStmt : Stmt
     {
-        std::unique_ptr<Expr> expr;
-        ExprStmt(std::unique_ptr<Expr> e) : expr(std::move(e)) {}
+        static constexpr NodeKind Kind = NodeKind::ExprStmt;
+
+        Ptr<Expr> expr;
+        ExprStmt(Ptr<Expr> e) : Stmt(Kind), expr(std::move(e)) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct ReturnStmt : Stmt
     {
-        std::unique_ptr<Expr> expr;
-        ReturnStmt(std::unique_ptr<Expr> e) : expr(std::move(e)) {}
+        static constexpr NodeKind Kind = NodeKind::ReturnStmt;
+
+        Ptr<Expr> expr;
+        ReturnStmt(Ptr<Expr> e) : Stmt(Kind), expr(std::move(e)) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct VarDecl : Stmt
     {
-        std::string name;
+        static constexpr NodeKind Kind = NodeKind::VarDecl;
+
+        Symbol name;
 
-        std::unique_ptr<Type> type;
+        Ptr<Type> type;
 
-        std::unique_ptr<Expr> init;
+        Ptr<Expr> init;
 
-        VarDecl(const std::string &n, std::unique_ptr<Expr> i) : name(n), type(nullptr), init(std::move(i)) {}
+        VarDecl(Symbol n, Ptr<Expr> i) : Stmt(Kind), name(n), type(nullptr), init(std::move(i)) {}
 
-        VarDecl(const std::string &n, std::unique_ptr<Type> t, std::unique_ptr<Expr> i)
-            : name(n), type(std::move(t)), init(std::move(i)) {}
+        VarDecl(Symbol n, Ptr<Type> t, Ptr<Expr> i)
+            : Stmt(Kind), name(n), type(std::move(t)), init(std::move(i)) {}
 
-        VarDecl(const std::string &n, std::unique_ptr<Type> t)
-            : name(n), type(std::move(t)), init(nullptr) {}
+        VarDecl(Symbol n, Ptr<Type> t)
+            : Stmt(Kind), name(n), type(std::move(t)), init(nullptr) {}
 
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct AssignStmt : Stmt
     {
-        std::unique_ptr<Expr> target;
-        std::unique_ptr<Expr> value;
-        AssignStmt(std::unique_ptr<Expr> target_, std::unique_ptr<Expr> value_)
-            : target(std::move(target_)), value(std::move(value_)) {}
+        static constexpr NodeKind Kind = NodeKind::AssignStmt;
+
+        Ptr<Expr> target;
+        Ptr<Expr> value;
+        AssignStmt(Ptr<Expr> target_, Ptr<Expr> value_)
+            : Stmt(Kind), target(std::move(target_)), value(std::move(value_)) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct BlockStmt : Stmt
     {
-        std::vector<std::unique_ptr<Stmt>> stmts;
+        static constexpr NodeKind Kind = NodeKind::BlockStmt;
+
+        List<Ptr<Stmt>> stmts;
+        explicit BlockStmt(List<Ptr<Stmt>> s) : Stmt(Kind), stmts(std::move(s)) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct IfStmt : Stmt
     {
-        std::unique_ptr<Expr> cond;
-        std::unique_ptr<BlockStmt> then_blk;
-        std::unique_ptr<BlockStmt> else_blk;
-        IfStmt(std::unique_ptr<Expr> c, std::unique_ptr<BlockStmt> t, std::unique_ptr<BlockStmt> e)
-            : cond(std::move(c)), then_blk(std::move(t)), else_blk(std::move(e)) {}
+        static constexpr NodeKind Kind = NodeKind::IfStmt;
+
+        Ptr<Expr> cond;
+        Ptr<BlockStmt> then_blk;
+        Ptr<BlockStmt> else_blk;
+        IfStmt(Ptr<Expr> c, Ptr<BlockStmt> t, Ptr<BlockStmt> e)
+            : Stmt(Kind), cond(std::move(c)), then_blk(std::move(t)), else_blk(std::move(e)) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct ForInStmt : Stmt
     {
-        std::string var;
+        static constexpr NodeKind Kind = NodeKind::ForInStmt;
 
-        std::unique_ptr<Type> var_type;
+        Symbol var;
 
-        std::unique_ptr<Expr> iterable;
-        std::unique_ptr<BlockStmt> body;
+        Ptr<Type> var_type;
 
-        ForInStmt(const std::string &v, std::unique_ptr<Expr> it, std::unique_ptr<BlockStmt> b)
-            : var(v), var_type(nullptr), iterable(std::move(it)), body(std::move(b)) {}
+        Ptr<Expr> iterable;
+        Ptr<BlockStmt> body;
 
-        ForInStmt(const std::string &v, std::unique_ptr<Type> vt, std::unique_ptr<Expr> it, std::unique_ptr<BlockStmt> b)
-            : var(v), var_type(std::move(vt)), iterable(std::move(it)), body(std::move(b)) {}
+        ForInStmt(Symbol v, Ptr<Expr> it, Ptr<BlockStmt> b)
+            : Stmt(Kind), var(v), var_type(nullptr), iterable(std::move(it)), body(std::move(b)) {}
+
+        ForInStmt(Symbol v, Ptr<Type> vt, Ptr<Expr> it, Ptr<BlockStmt> b)
+            : Stmt(Kind), var(v), var_type(std::move(vt)), iterable(std::move(it)), body(std::move(b)) {}
 
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct ForStmt : Stmt
     {
-        std::unique_ptr<BlockStmt> body;
-        ForStmt(std::unique_ptr<BlockStmt> b) : body(std::move(b)) {}
+        static constexpr NodeKind Kind = NodeKind::ForStmt;
+
+        Ptr<BlockStmt> body;
+        ForStmt(Ptr<BlockStmt> b) : Stmt(Kind), body(std::move(b)) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct ForCStyleStmt : Stmt
     {
-        std::unique_ptr<Stmt> init;
-        std::unique_ptr<Expr> cond;
-        std::unique_ptr<Expr> post;
-        std::unique_ptr<BlockStmt> body;
+        static constexpr NodeKind Kind = NodeKind::ForCStyleStmt;
 
-        ForCStyleStmt(std::unique_ptr<Stmt> init_,
-                      std::unique_ptr<Expr> cond_,
-                      std::unique_ptr<Expr> post_,
-                      std::unique_ptr<BlockStmt> body_)
-            : init(std::move(init_)), cond(std::move(cond_)), post(std::move(post_)), body(std::move(body_)) {}
+        Ptr<Stmt> init;
+        Ptr<Expr> cond;
+        Ptr<Expr> post;
+        Ptr<BlockStmt> body;
+
+        ForCStyleStmt(Ptr<Stmt> init_,
+                      Ptr<Expr> cond_,
+                      Ptr<Expr> post_,
+                      Ptr<BlockStmt> body_)
+            : Stmt(Kind), init(std::move(init_)), cond(std::move(cond_)), post(std::move(post_)), body(std::move(body_)) {}
 
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct BreakStmt : Stmt
     {
-        BreakStmt() {}
+        static constexpr NodeKind Kind = NodeKind::BreakStmt;
+
+        BreakStmt() : Stmt(Kind) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct ContinueStmt : Stmt
     {
-        ContinueStmt() {}
+        static constexpr NodeKind Kind = NodeKind::ContinueStmt;
+
+        ContinueStmt() : Stmt(Kind) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct PackageDecl : Decl
     {
-        std::string name;
-        PackageDecl(const std::string &n) : name(n) {}
+        static constexpr NodeKind Kind = NodeKind::PackageDecl;
+
+        std::string_view name;
+        PackageDecl(std::string_view n) : Decl(Kind), name(n) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
@@ -352,59 +460,134 @@ namespace ast
 
     struct ImportDecl : Decl
     {
+        static constexpr NodeKind Kind = NodeKind::ImportDecl;
 
-        std::string path;
+        std::string_view path;
 
-        std::vector<std::string> path_parts;
+        List<std::string_view> path_parts;
 
-        std::optional<std::string> alias;
+        std::optional<std::string_view> alias;
 
-        ImportDecl(const std::string &p) : path(p) {}
-        ImportDecl(const std::string &p, const std::optional<std::string> &a) : path(p), alias(a) {}
+        ImportDecl(std::string_view p, List<std::string_view> parts, std::optional<std::string_view> a = std::nullopt)
+            : Decl(Kind), path(p), path_parts(std::move(parts)), alias(a) {}
 
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct Param
     {
-        std::string name;
-        std::unique_ptr<Type> type;
+        Symbol name;
+        Ptr<Type> type;
         bool variadic = false;
 
-        Param(std::string n, std::unique_ptr<Type> t, bool v = false)
-            : name(std::move(n)), type(std::move(t)), variadic(v) {}
+        Param(Symbol n, Ptr<Type> t, bool v = false)
+            : name(n), type(std::move(t)), variadic(v) {}
+    };
+
+    struct FuncDecl;
+
+    // Parses function bodies the parser skipped (see
+    // path::Parser::set_lazy_bodies). Owned by the Program.
+    struct DeferredBodies
+    {
+        virtual ~DeferredBodies() = default;
+        // Parses the skipped body of `fn` into it under the parser's lock,
+        // unless another thread already has. nullptr when the body has
+        // errors; they are kept for take_errors.
+        virtual BlockStmt *load_body(const FuncDecl &fn) = 0;
+        // Errors from the bodies parsed so far, in the order they were found.
+        virtual std::vector<std::string> take_errors() = 0;
     };
 
     struct FuncDecl : Decl
     {
-        std::string name;
-        std::optional<std::string> receiver_name;
-        std::vector<Param> params;
-        std::unique_ptr<Type> ret_type;
+        static constexpr NodeKind Kind = NodeKind::FuncDecl;
+
+        Symbol name;
+        std::optional<Symbol> receiver_name;
+        List<Param> params;
+        Ptr<Type> ret_type;
         bool is_pub = false;
-        std::unique_ptr<BlockStmt> body;
+        mutable Ptr<BlockStmt> body;
 
-        FuncDecl(const std::string &n,
-                 std::vector<Param> p,
-                 std::unique_ptr<Type> r,
+        // Set instead of `body` when the parser skipped it; get_body()
+        // parses it on first use. Only DeferredBodies::load_body writes
+        // `body` and clears this, both under its lock.
+        mutable std::atomic<DeferredBodies *> deferred{nullptr};
+        uint32_t body_token = 0;
+
+        FuncDecl(Symbol n,
+                 List<Param> p,
+                 Ptr<Type> r,
                  bool pub,
-                 std::unique_ptr<BlockStmt> b,
-                 const std::optional<std::string> &recv = std::nullopt)
-            : name(n), receiver_name(recv), params(std::move(p)), ret_type(std::move(r)), is_pub(pub), body(std::move(b)) {}
+                 Ptr<BlockStmt> b,
+                 std::optional<Symbol> recv = std::nullopt)
+            : Decl(Kind), name(n), receiver_name(recv), params(std::move(p)), ret_type(std::move(r)), is_pub(pub), body(std::move(b)) {}
+
+        bool body_pending() const { return deferred.load(std::memory_order_acquire) != nullptr; }
+        // Safe to call from several threads at once, even on the same node:
+        // the first call parses a skipped body under the deferred parser's
+        // lock and the rest see its result. A skipped body that fails to
+        // parse comes back null.
+        BlockStmt *get_body() const
+        {
+            if (DeferredBodies *d = deferred.load(std::memory_order_acquire))
+                return d->load_body(*this);
+            return body.get();
+        }
 
         void print(std::ostream &os, int indent = 0) const override;
     };
 
     struct StmtDecl : Decl
     {
-        std::unique_ptr<Stmt> stmt;
-        StmtDecl(std::unique_ptr<Stmt> s) : stmt(std::move(s)) {}
+        static constexpr NodeKind Kind = NodeKind::StmtDecl;
+
+        Ptr<Stmt> stmt;
+        StmtDecl(Ptr<Stmt> s) : Decl(Kind), stmt(std::move(s)) {}
         void print(std::ostream &os, int indent = 0) const override;
     };
 
+    // The root is the one node not placed in an arena. It keeps alive the
+    // arenas its declarations live in; a merged program shares those of every
+    // file it was assembled from, and the last owner releases them in bulk.
     struct Program : Node
     {
-        std::vector<std::unique_ptr<Decl>> decls;
+        static constexpr NodeKind Kind = NodeKind::Program;
+
+        std::vector<Ptr<Decl>> decls;
+        std::vector<std::shared_ptr<Arena>> arenas;
+        std::vector<std::shared_ptr<DeferredBodies>> deferred;
+
+        Program() : Node(Kind) {}
+
+        Arena &arena()
+        {
+            if (arenas.empty())
+                arenas.push_back(std::make_shared<Arena>());
+            return *arenas.front();
+        }
+
+        void adopt(const Program &other)
+        {
+            arenas.insert(arenas.end(), other.arenas.begin(), other.arenas.end());
+            deferred.insert(deferred.end(), other.deferred.begin(), other.deferred.end());
+        }
+
+        // Errors in bodies parsed after the parse (see DeferredBodies),
+        // grouped by file in the order the files were adopted. Each is
+        // handed out once, even when several programs share a file.
+        std::vector<std::string> take_late_errors()
+        {
+            std::vector<std::string> out;
+            for (auto &d : deferred)
+            {
+                auto errors = d->take_errors();
+                out.insert(out.end(), std::make_move_iterator(errors.begin()), std::make_move_iterator(errors.end()));
+            }
+            return out;
+        }
+
         void print(std::ostream &os, int indent = 0) const override;
     };
 
@@ -416,67 +599,52 @@ namespace ast
             return;
         }
 
-        if (auto p = dynamic_cast<const Ident *>(e))
+        switch (e->kind)
         {
-            os << "Expr: Ident (name = \"" << p->name << "\")\n";
+        case NodeKind::Ident:
+            os << "Expr: Ident (name = \"" << static_cast<const Ident *>(e)->name << "\")\n";
             return;
-        }
-        if (auto p = dynamic_cast<const Literal *>(e))
+        case NodeKind::Literal:
         {
+            auto p = static_cast<const Literal *>(e);
             os << "Expr: Literal (raw = \"" << p->raw << "\"";
             os << ", token = " << static_cast<int>(p->t) << ")\n";
             return;
         }
-        if (auto p = dynamic_cast<const UnaryExpr *>(e))
-        {
-            os << "Expr: UnaryExpr (op = \"" << p->op << "\")\n";
+        case NodeKind::UnaryExpr:
+            os << "Expr: UnaryExpr (op = \"" << static_cast<const UnaryExpr *>(e)->op << "\")\n";
             return;
-        }
-        if (auto p = dynamic_cast<const BinaryExpr *>(e))
-        {
-            os << "Expr: BinaryExpr (op = \"" << p->op << "\")\n";
+        case NodeKind::BinaryExpr:
+            os << "Expr: BinaryExpr (op = \"" << static_cast<const BinaryExpr *>(e)->op << "\")\n";
             return;
-        }
-        if (auto p = dynamic_cast<const CallExpr *>(e))
-        {
-            os << "Expr: CallExpr (args = " << p->args.size() << ")\n";
+        case NodeKind::CallExpr:
+            os << "Expr: CallExpr (args = " << static_cast<const CallExpr *>(e)->args.size() << ")\n";
             return;
-        }
-        if (auto p = dynamic_cast<const ArrayLiteral *>(e))
-        {
-            os << "Expr: ArrayLiteral (elements = " << p->elements.size() << ")\n";
+        case NodeKind::ArrayLiteral:
+            os << "Expr: ArrayLiteral (elements = " << static_cast<const ArrayLiteral *>(e)->elements.size() << ")\n";
             return;
-        }
-        if (auto p = dynamic_cast<const ByteArrayLiteral *>(e))
-        {
-            os << "Expr: ByteArrayLiteral (elems = " << p->elems.size() << ")\n";
+        case NodeKind::ByteArrayLiteral:
+            os << "Expr: ByteArrayLiteral (elems = " << static_cast<const ByteArrayLiteral *>(e)->elems.size() << ")\n";
             return;
-        }
-        if (auto p = dynamic_cast<const MemberExpr *>(e))
-        {
-            os << "Expr: MemberExpr (member = \"" << p->member << "\")\n";
+        case NodeKind::MemberExpr:
+            os << "Expr: MemberExpr (member = \"" << static_cast<const MemberExpr *>(e)->member << "\")\n";
             return;
-        }
-        if (auto p = dynamic_cast<const IndexExpr *>(e))
-        {
+        case NodeKind::IndexExpr:
             os << "Expr: IndexExpr\n";
             return;
-        }
-        if (auto p = dynamic_cast<const PostfixExpr *>(e))
-        {
-            os << "Expr: PostfixExpr (op = \"" << p->op << "\")\n";
+        case NodeKind::PostfixExpr:
+            os << "Expr: PostfixExpr (op = \"" << static_cast<const PostfixExpr *>(e)->op << "\")\n";
             return;
-        }
-        if (auto p = dynamic_cast<const StructLiteral *>(e))
-        {
-            os << "Expr: StructLiteral (fields = " << p->inits.size() << ")\n";
+        case NodeKind::StructLiteral:
+            os << "Expr: StructLiteral (fields = " << static_cast<const StructLiteral *>(e)->inits.size() << ")\n";
+            return;
+        default:
+            os << "Expr: <unknown concrete type>\n";
             return;
         }
-
-        os << "Expr: <unknown concrete type>\n";
     }
 
-    inline void print_expr_kind(const std::unique_ptr<Expr> &ue, std::ostream &os = std::cout)
+    inline void print_expr_kind(Ptr<Expr> ue, std::ostream &os = std::cout)
     {
         print_expr_kind(ue.get(), os);
     }
@@ -0,0 +1,59 @@
+#include "intern.h"
+#include <mutex>
+#include <unordered_set>
+
+namespace ast
+{
+    const detail::InternEntry Symbol::empty_{std::string(), std::hash<std::string_view>()(std::string_view())};
+
+    namespace
+    {
+        using detail::InternEntry;
+
+        struct Hash
+        {
+            using is_transparent = void;
+            size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>()(s); }
+            size_t operator()(const InternEntry &e) const noexcept { return e.hash; }
+        };
+
+        struct Eq
+        {
+            using is_transparent = void;
+            bool operator()(const InternEntry &a, const InternEntry &b) const { return a.text == b.text; }
+            bool operator()(std::string_view a, const InternEntry &b) const { return a == b.text; }
+            bool operator()(const InternEntry &a, std::string_view b) const { return a.text == b; }
+        };
+
+        // Node-based, so entries never move once inserted and a Symbol can
+        // hold a plain pointer to its entry without taking the lock to read.
+        struct Table
+        {
+            std::mutex mu;
+            std::unordered_set<InternEntry, Hash, Eq> names;
+
+            Table() { names.reserve(4096); }
+        };
+
+        // Never destroyed, so symbols held by other statics stay valid at exit.
+        Table &table()
+        {
+            static Table *t = new Table();
+            return *t;
+        }
+    }
+
+    Symbol intern(std::string_view s)
+    {
+        if (s.empty())
+            return Symbol();
+
+        size_t h = std::hash<std::string_view>()(s);
+        Table &t = table();
+        std::lock_guard<std::mutex> lock(t.mu);
+        auto it = t.names.find(s);
+        if (it == t.names.end())
+            it = t.names.insert(InternEntry{std::string(s), h}).first;
+        return Symbol(&*it);
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace ast
+{
+    namespace detail
+    {
+        struct InternEntry
+        {
+            std::string text;
+            size_t hash;
+        };
+    }
+
+    // An interned identifier. Every distinct spelling is stored once in a
+    // process-wide table, so two symbols are equal exactly when they point at
+    // the same entry: comparing and hashing them never touches the characters.
+    // The default symbol is the empty name.
+    class Symbol
+    {
+    public:
+        Symbol() = default;
+
+        const std::string &str() const { return e_->text; }
+        std::string_view view() const { return e_->text; }
+        const char *c_str() const { return e_->text.c_str(); }
+        size_t size() const { return e_->text.size(); }
+        bool empty() const { return e_->text.empty(); }
+
+        // Same value as std::hash<std::string> of the text, computed once at
+        // intern time, so hash containers keyed by symbols iterate in the same
+        // order from run to run.
+        size_t hash() const { return e_->hash; }
+
+        friend bool operator==(Symbol a, Symbol b) { return a.e_ == b.e_; }
+        friend bool operator!=(Symbol a, Symbol b) { return a.e_ != b.e_; }
+        friend bool operator==(Symbol a, std::string_view b) { return a.view() == b; }
+        friend bool operator!=(Symbol a, std::string_view b) { return a.view() != b; }
+
+        friend std::ostream &operator<<(std::ostream &os, Symbol s) { return os << s.str(); }
+        friend std::string operator+(const std::string &a, Symbol b) { return a + b.str(); }
+        friend std::string operator+(Symbol a, const std::string &b) { return a.str() + b; }
+        friend std::string operator+(const char *a, Symbol b) { return a + b.str(); }
+        friend std::string operator+(Symbol a, const char *b) { return a.str() + b; }
+
+    private:
+        friend Symbol intern(std::string_view s);
+
+        explicit Symbol(const detail::InternEntry *e) : e_(e) {}
+
+        static const detail::InternEntry empty_;
+        const detail::InternEntry *e_ = &empty_;
+    };
+
+    // Returns the symbol for `s`, adding it to the table on first use.
+    // Safe to call from several threads.
+    Symbol intern(std::string_view s);
+}
+
+template <>
+struct std::hash<ast::Symbol>
+{
+    size_t operator()(ast::Symbol s) const noexcept { return s.hash(); }
+};
@@ -0,0 +1,729 @@
+#include "serialize.h"
+#include "../lexer/source.h"
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+namespace ast
+{
+    namespace
+    {
+        constexpr char magic[4] = {'E', 'A', 'S', 'T'};
+        constexpr uint8_t null_tag = 0xff;
+
+        // Strings are written once, in first-use order; everything after the
+        // table refers to them by index.
+        class Writer
+        {
+        public:
+            std::string finish(const Program &prog)
+            {
+                count(prog.decls.size());
+                for (const auto &d : prog.decls)
+                    node(d.get());
+
+                std::string table;
+                for (std::string_view s : strings_)
+                {
+                    varint(table, s.size());
+                    table.append(s.data(), s.size());
+                }
+
+                std::string out(magic, sizeof(magic));
+                for (int i = 0; i < 4; ++i)
+                    out.push_back(static_cast<char>((binary_version >> (8 * i)) & 0xff));
+                varint(out, strings_.size());
+                varint(out, table.size());
+                out += table;
+                out += body_;
+                return out;
+            }
+
+        private:
+            std::string body_;
+            std::unordered_map<std::string_view, uint32_t> ids_;
+            std::vector<std::string_view> strings_;
+
+            static void varint(std::string &out, uint64_t v)
+            {
+                while (v >= 0x80)
+                {
+                    out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+                    v >>= 7;
+                }
+                out.push_back(static_cast<char>(v));
+            }
+
+            void byte(uint8_t b) { body_.push_back(static_cast<char>(b)); }
+            void flag(bool b) { byte(b ? 1 : 0); }
+            void count(uint64_t n) { varint(body_, n); }
+
+            void str(std::string_view s)
+            {
+                auto [it, added] = ids_.try_emplace(s, static_cast<uint32_t>(strings_.size()));
+                if (added)
+                    strings_.push_back(s);
+                varint(body_, it->second);
+            }
+
+            void sym(Symbol s) { str(s.view()); }
+
+            template <typename T>
+            void nodes(const List<Ptr<T>> &list)
+            {
+                count(list.size());
+                for (const auto &n : list)
+                    node(n.get());
+            }
+
+            void field(const StructField *f)
+            {
+                flag(f != nullptr);
+                if (!f)
+                    return;
+                sym(f->name);
+                node(f->type.get());
+                node(f->inline_struct.get());
+                flag(f->is_pub);
+            }
+
+            void node(const Node *n)
+            {
+                if (!n)
+                {
+                    byte(null_tag);
+                    return;
+                }
+                byte(static_cast<uint8_t>(n->kind));
+
+                switch (n->kind)
+                {
+                case NodeKind::NamedType:
+                    sym(static_cast<const NamedType *>(n)->name);
+                    return;
+                case NodeKind::PointerType:
+                    node(static_cast<const PointerType *>(n)->base.get());
+                    return;
+                case NodeKind::ArrayType:
+                {
+                    auto t = static_cast<const ArrayType *>(n);
+                    node(t->elem.get());
+                    flag(t->is_slice);
+                    count(t->size);
+                    return;
+                }
+                case NodeKind::FuncType:
+                {
+                    auto t = static_cast<const FuncType *>(n);
+                    nodes(t->params);
+                    node(t->ret.get());
+                    return;
+                }
+
+                case NodeKind::Ident:
+                    sym(static_cast<const Ident *>(n)->name);
+                    return;
+                case NodeKind::Literal:
+                {
+                    auto e = static_cast<const Literal *>(n);
+                    str(e->raw);
+                    count(static_cast<uint64_t>(e->t));
+                    return;
+                }
+                case NodeKind::UnaryExpr:
+                {
+                    auto e = static_cast<const UnaryExpr *>(n);
+                    str(e->op);
+                    node(e->rhs.get());
+                    return;
+                }
+                case NodeKind::BinaryExpr:
+                {
+                    auto e = static_cast<const BinaryExpr *>(n);
+                    str(e->op);
+                    node(e->left.get());
+                    node(e->right.get());
+                    return;
+                }
+                case NodeKind::CallExpr:
+                {
+                    auto e = static_cast<const CallExpr *>(n);
+                    node(e->callee.get());
+                    nodes(e->args);
+                    return;
+                }
+                case NodeKind::ArrayLiteral:
+                {
+                    auto e = static_cast<const ArrayLiteral *>(n);
+                    node(e->array_type.get());
+                    nodes(e->elements);
+                    return;
+                }
+                case NodeKind::ByteArrayLiteral:
+                    nodes(static_cast<const ByteArrayLiteral *>(n)->elems);
+                    return;
+                case NodeKind::MemberExpr:
+                {
+                    auto e = static_cast<const MemberExpr *>(n);
+                    node(e->object.get());
+                    sym(e->member);
+                    return;
+                }
+                case NodeKind::IndexExpr:
+                {
+                    auto e = static_cast<const IndexExpr *>(n);
+                    node(e->collection.get());
+                    node(e->index.get());
+                    return;
+                }
+                case NodeKind::PostfixExpr:
+                {
+                    auto e = static_cast<const PostfixExpr *>(n);
+                    str(e->op);
+                    node(e->lhs.get());
+                    return;
+                }
+                case NodeKind::StructLiteral:
+                {
+                    auto e = static_cast<const StructLiteral *>(n);
+                    node(e->type.get());
+                    count(e->inits.size());
+                    for (const auto &init : e->inits)
+                    {
+                        flag(init.name.has_value());
+                        if (init.name)
+                            sym(*init.name);
+                        node(init.value.get());
+                    }
+                    return;
+                }
+
+                case NodeKind::ExprStmt:
+                    node(static_cast<const ExprStmt *>(n)->expr.get());
+                    return;
+                case NodeKind::ReturnStmt:
+                    node(static_cast<const ReturnStmt *>(n)->expr.get());
+                    return;
+                case NodeKind::VarDecl:
+                {
+                    auto s = static_cast<const VarDecl *>(n);
+                    sym(s->name);
+                    node(s->type.get());
+                    node(s->init.get());
+                    return;
+                }
+                case NodeKind::AssignStmt:
+                {
+                    auto s = static_cast<const AssignStmt *>(n);
+                    node(s->target.get());
+                    node(s->value.get());
+                    return;
+                }
+                case NodeKind::BlockStmt:
+                    nodes(static_cast<const BlockStmt *>(n)->stmts);
+                    return;
+                case NodeKind::IfStmt:
+                {
+                    auto s = static_cast<const IfStmt *>(n);
+                    node(s->cond.get());
+                    node(s->then_blk.get());
+                    node(s->else_blk.get());
+                    return;
+                }
+                case NodeKind::ForInStmt:
+                {
+                    auto s = static_cast<const ForInStmt *>(n);
+                    sym(s->var);
+                    node(s->var_type.get());
+                    node(s->iterable.get());
+                    node(s->body.get());
+                    return;
+                }
+                case NodeKind::ForStmt:
+                    node(static_cast<const ForStmt *>(n)->body.get());
+                    return;
+                case NodeKind::ForCStyleStmt:
+                {
+                    auto s = static_cast<const ForCStyleStmt *>(n);
+                    node(s->init.get());
+                    node(s->cond.get());
+                    node(s->post.get());
+                    node(s->body.get());
+                    return;
+                }
+                case NodeKind::BreakStmt:
+                case NodeKind::ContinueStmt:
+                    return;
+
+                case NodeKind::StructDecl:
+                {
+                    auto d = static_cast<const StructDecl *>(n);
+                    sym(d->name);
+                    flag(d->is_pub);
+                    count(d->fields.size());
+                    for (const auto &f : d->fields)
+                        field(f.get());
+                    nodes(d->nested_decls);
+                    return;
+                }
+                case NodeKind::PackageDecl:
+                    str(static_cast<const PackageDecl *>(n)->name);
+                    return;
+                case NodeKind::ImportDecl:
+                {
+                    auto d = static_cast<const ImportDecl *>(n);
+                    str(d->path);
+                    count(d->path_parts.size());
+                    for (std::string_view part : d->path_parts)
+                        str(part);
+                    flag(d->alias.has_value());
+                    if (d->alias)
+                        str(*d->alias);
+                    return;
+                }
+                case NodeKind::FuncDecl:
+                {
+                    auto d = static_cast<const FuncDecl *>(n);
+                    sym(d->name);
+                    flag(d->receiver_name.has_value());
+                    if (d->receiver_name)
+                        sym(*d->receiver_name);
+                    count(d->params.size());
+                    for (const auto &p : d->params)
+                    {
+                        sym(p.name);
+                        node(p.type.get());
+                        flag(p.variadic);
+                    }
+                    node(d->ret_type.get());
+                    flag(d->is_pub);
+                    node(d->get_body());
+                    return;
+                }
+                case NodeKind::StmtDecl:
+                    node(static_cast<const StmtDecl *>(n)->stmt.get());
+                    return;
+
+                case NodeKind::Program:
+                    return;
+                }
+            }
+        };
+
+        // Every read is bounds-checked; the first bad byte clears ok_ and the
+        // rest of the load unwinds with nulls.
+        class Reader
+        {
+        public:
+            Reader(std::string_view data, Arena &arena)
+                : p_(data.data()), end_(data.data() + data.size()), arena_(arena) {}
+
+            bool read(Program &prog)
+            {
+                const char *data_end = end_;
+                if (size_t(end_ - p_) < sizeof(magic) + 4 || std::memcmp(p_, magic, sizeof(magic)) != 0)
+                    return false;
+                p_ += sizeof(magic);
+                uint32_t version = 0;
+                for (int i = 0; i < 4; ++i)
+                    version |= uint32_t(uint8_t(*p_++)) << (8 * i);
+                if (version != binary_version)
+                    return false;
+
+                uint64_t n = count();
+                uint64_t table_size = varint();
+                if (!ok_ || table_size > uint64_t(end_ - p_))
+                    return false;
+
+                // One copy puts every name in the arena; the views below
+                // point into it.
+                std::string_view table = arena_.str(std::string_view(p_, table_size));
+                const char *rest = p_ + table_size;
+                p_ = table.data();
+                end_ = table.data() + table.size();
+                strings_.reserve(n);
+                for (uint64_t i = 0; i < n && ok_; ++i)
+                {
+                    uint64_t len = varint();
+                    if (len > uint64_t(end_ - p_))
+                        return false;
+                    strings_.push_back(std::string_view(p_, len));
+                    p_ += len;
+                }
+                symbols_.resize(strings_.size());
+                interned_.resize(strings_.size(), 0);
+                p_ = rest;
+                end_ = data_end;
+
+                uint64_t decls = count();
+                prog.decls.reserve(decls);
+                for (uint64_t i = 0; i < decls && ok_; ++i)
+                    prog.decls.push_back(child<Decl>());
+                return ok_ && p_ == end_;
+            }
+
+        private:
+            const char *p_;
+            const char *end_;
+            Arena &arena_;
+            std::vector<std::string_view> strings_;
+            std::vector<Symbol> symbols_;
+            std::vector<char> interned_;
+            bool ok_ = true;
+
+            bool fail()
+            {
+                ok_ = false;
+                return false;
+            }
+
+            uint8_t byte()
+            {
+                if (p_ == end_)
+                    return fail(), 0;
+                return uint8_t(*p_++);
+            }
+
+            bool flag() { return byte() != 0; }
+
+            uint64_t varint()
+            {
+                uint64_t v = 0;
+                for (int shift = 0; shift < 64; shift += 7)
+                {
+                    uint8_t b = byte();
+                    if (!ok_)
+                        return 0;
+                    v |= uint64_t(b & 0x7f) << shift;
+                    if (!(b & 0x80))
+                        return v;
+                }
+                return fail(), 0;
+            }
+
+            // Every element takes at least one byte, so a count larger than
+            // what is left is corrupt and never reaches an allocation.
+            uint64_t count()
+            {
+                uint64_t n = varint();
+                if (n > uint64_t(end_ - p_))
+                    return fail(), 0;
+                return n;
+            }
+
+            std::string_view str()
+            {
+                uint64_t i = varint();
+                if (i >= strings_.size())
+                    return fail(), std::string_view();
+                return strings_[i];
+            }
+
+            Symbol sym()
+            {
+                uint64_t i = varint();
+                if (i >= strings_.size())
+                    return fail(), Symbol();
+                if (!interned_[i])
+                {
+                    symbols_[i] = intern(strings_[i]);
+                    interned_[i] = 1;
+                }
+                return symbols_[i];
+            }
+
+            template <typename T, typename... Args>
+            Ptr<T> make(Args &&...args)
+            {
+                return Ptr<T>(arena_.make<T>(std::forward<Args>(args)...));
+            }
+
+            template <typename T>
+            List<T> list()
+            {
+                return List<T>(&arena_);
+            }
+
+            template <typename T>
+            static bool fits(NodeKind k)
+            {
+                if constexpr (std::is_same_v<T, Type>)
+                    return k <= NodeKind::FuncType;
+                else if constexpr (std::is_same_v<T, Expr>)
+                    return k >= NodeKind::Ident && k <= NodeKind::StructLiteral;
+                else if constexpr (std::is_same_v<T, Stmt>)
+                    return k >= NodeKind::ExprStmt && k <= NodeKind::ContinueStmt;
+                else if constexpr (std::is_same_v<T, Decl>)
+                    return k >= NodeKind::StructDecl && k <= NodeKind::StmtDecl;
+                else
+                    return k == T::Kind;
+            }
+
+            // A child whose kind is not allowed in its slot is corrupt.
+            template <typename T>
+            Ptr<T> child()
+            {
+                Node *n = node();
+                if (!n)
+                    return nullptr;
+                if (!fits<T>(n->kind))
+                    return fail(), nullptr;
+                return Ptr<T>(static_cast<T *>(n));
+            }
+
+            template <typename T>
+            List<Ptr<T>> children()
+            {
+                auto out = list<Ptr<T>>();
+                uint64_t n = count();
+                out.reserve(n);
+                for (uint64_t i = 0; i < n && ok_; ++i)
+                    out.push_back(child<T>());
+                return out;
+            }
+
+            Ptr<StructField> field()
+            {
+                if (!flag())
+                    return nullptr;
+                Symbol name = sym();
+                auto type = child<Type>();
+                auto f = make<StructField>(name, type);
+                f->inline_struct = child<StructDecl>();
+                f->is_pub = flag();
+                return f;
+            }
+
+            Node *node()
+            {
+                uint8_t tag = byte();
+                if (!ok_ || tag == null_tag)
+                    return nullptr;
+                if (tag >= uint8_t(NodeKind::Program))
+                    return fail(), nullptr;
+
+                switch (NodeKind(tag))
+                {
+                case NodeKind::NamedType:
+                    return make<NamedType>(sym()).get();
+                case NodeKind::PointerType:
+                    return make<PointerType>(child<Type>()).get();
+                case NodeKind::ArrayType:
+                {
+                    auto elem = child<Type>();
+                    bool slice = flag();
+                    size_t size = varint();
+                    return make<ArrayType>(elem, slice, size).get();
+                }
+                case NodeKind::FuncType:
+                {
+                    auto params = children<Type>();
+                    auto ret = child<Type>();
+                    return make<FuncType>(std::move(params), ret).get();
+                }
+
+                case NodeKind::Ident:
+                    return make<Ident>(sym()).get();
+                case NodeKind::Literal:
+                {
+                    std::string_view raw = str();
+                    auto t = TokenType(varint());
+                    return make<Literal>(raw, t).get();
+                }
+                case NodeKind::UnaryExpr:
+                {
+                    std::string_view op = str();
+                    return make<UnaryExpr>(op, child<Expr>()).get();
+                }
+                case NodeKind::BinaryExpr:
+                {
+                    std::string_view op = str();
+                    auto left = child<Expr>();
+                    auto right = child<Expr>();
+                    return make<BinaryExpr>(op, left, right).get();
+                }
+                case NodeKind::CallExpr:
+                {
+                    auto callee = child<Expr>();
+                    return make<CallExpr>(callee, children<Expr>()).get();
+                }
+                case NodeKind::ArrayLiteral:
+                {
+                    auto type = child<Type>();
+                    return make<ArrayLiteral>(type, children<Expr>()).get();
+                }
+                case NodeKind::ByteArrayLiteral:
+                    return make<ByteArrayLiteral>(children<Expr>()).get();
+                case NodeKind::MemberExpr:
+                {
+                    auto object = child<Expr>();
+                    return make<MemberExpr>(object, sym()).get();
+                }
+                case NodeKind::IndexExpr:
+                {
+                    auto collection = child<Expr>();
+                    auto index = child<Expr>();
+                    return make<IndexExpr>(collection, index).get();
+                }
+                case NodeKind::PostfixExpr:
+                {
+                    std::string_view op = str();
+                    return make<PostfixExpr>(op, child<Expr>()).get();
+                }
+                case NodeKind::StructLiteral:
+                {
+                    auto type = child<Type>();
+                    auto inits = list<StructFieldInit>();
+                    uint64_t n = count();
+                    inits.reserve(n);
+                    for (uint64_t i = 0; i < n && ok_; ++i)
+                    {
+                        std::optional<Symbol> name;
+                        if (flag())
+                            name = sym();
+                        inits.emplace_back(name, child<Expr>());
+                    }
+                    return make<StructLiteral>(type, std::move(inits)).get();
+                }
+
+                case NodeKind::ExprStmt:
+                    return make<ExprStmt>(child<Expr>()).get();
+                case NodeKind::ReturnStmt:
+                    return make<ReturnStmt>(child<Expr>()).get();
+                case NodeKind::VarDecl:
+                {
+                    Symbol name = sym();
+                    auto type = child<Type>();
+                    auto init = child<Expr>();
+                    return make<VarDecl>(name, type, init).get();
+                }
+                case NodeKind::AssignStmt:
+                {
+                    auto target = child<Expr>();
+                    auto value = child<Expr>();
+                    return make<AssignStmt>(target, value).get();
+                }
+                case NodeKind::BlockStmt:
+                    return make<BlockStmt>(children<Stmt>()).get();
+                case NodeKind::IfStmt:
+                {
+                    auto cond = child<Expr>();
+                    auto then_blk = child<BlockStmt>();
+                    auto else_blk = child<BlockStmt>();
+                    return make<IfStmt>(cond, then_blk, else_blk).get();
+                }
+                case NodeKind::ForInStmt:
+                {
+                    Symbol var = sym();
+                    auto var_type = child<Type>();
+                    auto iterable = child<Expr>();
+                    auto body = child<BlockStmt>();
+                    return make<ForInStmt>(var, var_type, iterable, body).get();
+                }
+                case NodeKind::ForStmt:
+                    return make<ForStmt>(child<BlockStmt>()).get();
+                case NodeKind::ForCStyleStmt:
+                {
+                    auto init = child<Stmt>();
+                    auto cond = child<Expr>();
+                    auto post = child<Expr>();
+                    auto body = child<BlockStmt>();
+                    return make<ForCStyleStmt>(init, cond, post, body).get();
+                }
+                case NodeKind::BreakStmt:
+                    return make<BreakStmt>().get();
+                case NodeKind::ContinueStmt:
+                    return make<ContinueStmt>().get();
+
+                case NodeKind::StructDecl:
+                {
+                    Symbol name = sym();
+                    bool is_pub = flag();
+                    auto fields = list<Ptr<StructField>>();
+                    uint64_t n = count();
+                    fields.reserve(n);
+                    for (uint64_t i = 0; i < n && ok_; ++i)
+                        fields.push_back(field());
+                    auto d = make<StructDecl>(name, std::move(fields));
+                    d->is_pub = is_pub;
+                    d->nested_decls = children<Decl>();
+                    return d.get();
+                }
+                case NodeKind::PackageDecl:
+                    return make<PackageDecl>(str()).get();
+                case NodeKind::ImportDecl:
+                {
+                    std::string_view path = str();
+                    auto parts = list<std::string_view>();
+                    uint64_t n = count();
+                    parts.reserve(n);
+                    for (uint64_t i = 0; i < n && ok_; ++i)
+                        parts.push_back(str());
+                    std::optional<std::string_view> alias;
+                    if (flag())
+                        alias = str();
+                    return make<ImportDecl>(path, std::move(parts), alias).get();
+                }
+                case NodeKind::FuncDecl:
+                {
+                    Symbol name = sym();
+                    std::optional<Symbol> receiver;
+                    if (flag())
+                        receiver = sym();
+                    auto params = list<Param>();
+                    uint64_t n = count();
+                    params.reserve(n);
+                    for (uint64_t i = 0; i < n && ok_; ++i)
+                    {
+                        Symbol pname = sym();
+                        auto ptype = child<Type>();
+                        params.emplace_back(pname, ptype, flag());
+                    }
+                    auto ret = child<Type>();
+                    bool is_pub = flag();
+                    auto body = child<BlockStmt>();
+                    return make<FuncDecl>(name, std::move(params), ret, is_pub, body, receiver).get();
+                }
+                case NodeKind::StmtDecl:
+                    return make<StmtDecl>(child<Stmt>()).get();
+
+                case NodeKind::Program:
+                    break;
+                }
+                return fail(), nullptr;
+            }
+        };
+    }
+
+    std::string write_binary(const Program &prog)
+    {
+        return Writer().finish(prog);
+    }
+
+    bool save_binary(const Program &prog, const std::filesystem::path &path)
+    {
+        std::string data = write_binary(prog);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        return static_cast<bool>(out);
+    }
+
+    std::unique_ptr<Program> read_binary(std::string_view data)
+    {
+        auto prog = std::make_unique<Program>();
+        Reader reader(data, prog->arena());
+        if (!reader.read(*prog))
+            return nullptr;
+        return prog;
+    }
+
+    std::unique_ptr<Program> load_binary(const std::filesystem::path &path)
+    {
+        auto source = lex::SourceBuffer::open(path);
+        if (!source)
+            return nullptr;
+        return read_binary(source->view());
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "ast.h"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace ast
+{
+    // Compact binary form of a parsed file, so an unchanged source can be
+    // loaded without lexing or parsing it again.
+    //
+    // The file is a short header, one table holding every distinct name and
+    // spelling, then the tree in preorder: a kind byte per node followed by
+    // its fields, with names as table indices and counts as varints. Loading
+    // copies the table into the program's arena in one piece and rebuilds the
+    // nodes straight from the stream; no other fixups are needed.
+    constexpr uint32_t binary_version = 1;
+
+    std::string write_binary(const Program &prog);
+    bool save_binary(const Program &prog, const std::filesystem::path &path);
+
+    // nullptr when the data is truncated, malformed or from another version.
+    std::unique_ptr<Program> read_binary(std::string_view data);
+    std::unique_ptr<Program> load_binary(const std::filesystem::path &path);
+}
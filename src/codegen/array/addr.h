@@ -12,7 +12,7 @@ Value *CodeGen::codegen_index_addr(const ast::IndexExpr *ie)
 {
     Module *M = module.get();
 
-    DataLayout dl(M);
+    const DataLayout &dl = M->getDataLayout();
     unsigned ptrSizeBits = dl.getPointerSizeInBits();
     uint64_t ptrSizeBytes = ptrSizeBits / 8;
     Type *ptrIntTy = IntegerType::get(context, ptrSizeBits);
@@ -23,18 +23,18 @@ Value *CodeGen::codegen_index_addr(const ast::IndexExpr *ie)
     Value *colVal = this->codegen_expr(ie->collection.get());
     if (!colVal)
     {
-        errs() << "codegen_index_addr: colVal == nullptr\n";
+        error("codegen_index_addr: colVal == nullptr");
         return nullptr;
     }
 
     Value *idxVal = this->codegen_expr(ie->index.get());
     if (!idxVal)
     {
-        errs() << "codegen_index_addr: idxVal == nullptr\n";
+        error("codegen_index_addr: idxVal == nullptr");
         return nullptr;
     }
 
-    if (auto *id = dynamic_cast<const ast::Ident *>(ie->collection.get()))
+    if (auto *id = ast::as<ast::Ident>(ie->collection.get()))
     {
         std::string *ll = lookup_local_type(id->name);
         if (ll)
@@ -61,7 +61,7 @@ Value *CodeGen::codegen_index_addr(const ast::IndexExpr *ie)
                         idxVal = builder.CreateSExtOrTrunc(idxVal, i64Ty, "idx_i64");
                     else
                     {
-                        errs() << "codegen_index_addr: index is not integer for string_params\n";
+                        error("codegen_index_addr: index is not integer for string_params");
                         return nullptr;
                     }
                 }
@@ -93,7 +93,7 @@ Value *CodeGen::codegen_index_addr(const ast::IndexExpr *ie)
     }
     else
     {
-        errs() << "codegen_index_addr: unsupported collection value type\n";
+        error("codegen_index_addr: unsupported collection value type");
         return nullptr;
     }
 
@@ -104,7 +104,7 @@ Value *CodeGen::codegen_index_addr(const ast::IndexExpr *ie)
             idxVal = builder.CreateSExtOrTrunc(idxVal, i64Ty, "idx_i64");
         else
         {
-            errs() << "codegen_index_addr: index is not integer\n";
+            error("codegen_index_addr: index is not integer");
             return nullptr;
         }
     }
@@ -148,14 +148,14 @@ Value *CodeGen::codegen_index_addr(const ast::IndexExpr *ie)
     bool staticElemIsArrayPtr = false;
 
     const ast::Expr *collExpr = ie->collection.get();
-    if (const ast::ArrayLiteral *al = dynamic_cast<const ast::ArrayLiteral *>(collExpr))
+    if (const ast::ArrayLiteral *al = ast::as<ast::ArrayLiteral>(collExpr))
     {
         if (!al->elements.empty())
         {
             const ast::Expr *firstElem = al->elements[0].get();
-            if (dynamic_cast<const ast::ArrayLiteral *>(firstElem))
+            if (ast::as<ast::ArrayLiteral>(firstElem))
                 staticElemIsArrayStruct = true;
-            else if (dynamic_cast<const ast::IndexExpr *>(firstElem))
+            else if (ast::as<ast::IndexExpr>(firstElem))
                 staticElemIsArrayPtr = true;
         }
     }
@@ -222,7 +222,7 @@ Value *CodeGen::codegen_index_addr(const ast::IndexExpr *ie)
         return elemPtrI8;
     }
 
-    if (auto id = dynamic_cast<const ast::Ident *>(ie->collection.get()))
+    if (auto id = ast::as<ast::Ident>(ie->collection.get()))
     {
         std::string *ll = lookup_local_type(id->name);
         if (ll)
@@ -23,7 +23,7 @@ Value *CodeGen::codegen_append_call(const ast::CallExpr *ce)
     Type *i32Ty = IntegerType::get(context, 32);
     Type *i8Ty = IntegerType::get(context, 8);
     Type *i8ptrTy = detail::getI8PtrTy(context);
-    DataLayout dl(M);
+    const DataLayout &dl = M->getDataLayout();
     unsigned ptrSizeBits = dl.getPointerSizeInBits();
     uint64_t ptrSizeBytes = ptrSizeBits / 8;
 
@@ -36,7 +36,7 @@ Value *CodeGen::codegen_append_call(const ast::CallExpr *ce)
     if (!e)
         return nullptr;
 
-    if (auto id = dynamic_cast<const ast::Ident *>(e))
+    if (auto id = ast::as<ast::Ident>(e))
     {
         arr_lvalue_or_ptr = lookup_local(id->name);
         if (!arr_lvalue_or_ptr)
@@ -44,20 +44,20 @@ Value *CodeGen::codegen_append_call(const ast::CallExpr *ce)
 
         original_should_return_struct = (llvm::isa<AllocaInst>(arr_lvalue_or_ptr) || llvm::isa<GlobalVariable>(arr_lvalue_or_ptr));
     }
-    else if (auto ie = dynamic_cast<const ast::IndexExpr *>(e))
+    else if (auto ie = ast::as<ast::IndexExpr>(e))
     {
         idxExpr = ie;
     }
-    else if (auto ue = dynamic_cast<const ast::UnaryExpr *>(e))
+    else if (auto ue = ast::as<ast::UnaryExpr>(e))
     {
 
-        if (auto id2 = dynamic_cast<const ast::Ident *>(ue->rhs.get()))
+        if (auto id2 = ast::as<ast::Ident>(ue->rhs.get()))
         {
             arr_lvalue_or_ptr = lookup_local(id2->name);
             if (!arr_lvalue_or_ptr)
                 return nullptr;
         }
-        else if (auto ie2 = dynamic_cast<const ast::IndexExpr *>(ue->rhs.get()))
+        else if (auto ie2 = ast::as<ast::IndexExpr>(ue->rhs.get()))
         {
             idxExpr = ie2;
         }
@@ -142,7 +142,7 @@ Value *CodeGen::codegen_append_call(const ast::CallExpr *ce)
         }
         else
         {
-            errs() << "append: unsupported collection value type in index expr\n";
+            error("append: unsupported collection value type in index expr");
             return nullptr;
         }
 
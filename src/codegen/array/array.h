@@ -11,7 +11,7 @@ using namespace codegen;
 Value *CodeGen::codegen_array(const ast::ArrayLiteral *alit)
 {
     Module *M = module.get();
-    DataLayout dl(M);
+    const DataLayout &dl = M->getDataLayout();
 
     std::vector<Value *> elemVals;
     elemVals.reserve(alit->elements.size());
@@ -39,7 +39,7 @@ Value *CodeGen::codegen_array(const ast::ArrayLiteral *alit)
     Type *i32Ty = IntegerType::get(context, 32);
     Type *i8ptrTy = detail::getI8PtrTy(context);
 
-    DataLayout &dataLayout = dl;
+    const DataLayout &dataLayout = dl;
     uint64_t elemSizeBytes = (uint64_t)dataLayout.getTypeAllocSize(elemTy);
     Value *elemSizeConst = detail::constInt64(builder, elemSizeBytes);
 
@@ -13,7 +13,7 @@ Value *CodeGen::codegen_index(const ast::IndexExpr *ie)
 {
     Module *M = module.get();
 
-    DataLayout dl(M);
+    const DataLayout &dl = M->getDataLayout();
     unsigned ptrSizeBits = dl.getPointerSizeInBits();
     uint64_t ptrSizeBytes = ptrSizeBits / 8;
     Type *ptrIntTy = IntegerType::get(context, ptrSizeBits);
@@ -24,21 +24,22 @@ Value *CodeGen::codegen_index(const ast::IndexExpr *ie)
     Value *colVal = codegen_expr(ie->collection.get());
     if (!colVal)
     {
-        errs() << "codegen_index: colVal == nullptr\n";
+        error("codegen_index: colVal == nullptr");
         return nullptr;
     }
 
     Value *idxVal = codegen_expr(ie->index.get());
     if (!idxVal)
     {
-        errs() << "codegen_index: idxVal == nullptr\n";
+        error("codegen_index: idxVal == nullptr");
         return nullptr;
     }
 
-    if (auto id = dynamic_cast<const ast::Ident *>(ie->collection.get()))
+    if (auto id = ast::as<ast::Ident>(ie->collection.get()))
     {
 
-        std::cout << lookup_local_type(id->name)->c_str() << std::endl;
+        if (irdebug)
+            std::cout << lookup_local_type(id->name)->c_str() << std::endl;
 
         ParsedType pt = parse_type_chain(lookup_local_type(id->name)->c_str());
 
@@ -109,7 +110,7 @@ Value *CodeGen::codegen_index(const ast::IndexExpr *ie)
     }
     else
     {
-        errs() << "codegen_index: unsupported collection value type\n";
+        error("codegen_index: unsupported collection value type");
         return nullptr;
     }
 
@@ -120,7 +121,7 @@ Value *CodeGen::codegen_index(const ast::IndexExpr *ie)
             idxVal = builder.CreateSExtOrTrunc(idxVal, i64Ty, "idx_i64");
         else
         {
-            errs() << "codegen_index: index is not integer\n";
+            error("codegen_index: index is not integer");
             return nullptr;
         }
     }
@@ -163,14 +164,14 @@ Value *CodeGen::codegen_index(const ast::IndexExpr *ie)
     bool staticElemIsArrayPtr = false;
 
     const ast::Expr *collExpr = ie->collection.get();
-    if (const ast::ArrayLiteral *al = dynamic_cast<const ast::ArrayLiteral *>(collExpr))
+    if (const ast::ArrayLiteral *al = ast::as<ast::ArrayLiteral>(collExpr))
     {
         if (!al->elements.empty())
         {
             const ast::Expr *firstElem = al->elements[0].get();
-            if (dynamic_cast<const ast::ArrayLiteral *>(firstElem))
+            if (ast::as<ast::ArrayLiteral>(firstElem))
                 staticElemIsArrayStruct = true;
-            else if (dynamic_cast<const ast::IndexExpr *>(firstElem))
+            else if (ast::as<ast::IndexExpr>(firstElem))
                 staticElemIsArrayPtr = true;
         }
     }
@@ -218,15 +219,16 @@ Value *CodeGen::codegen_index(const ast::IndexExpr *ie)
     }
     else
     {
-        if (auto id = dynamic_cast<const ast::Ident *>(ie->collection.get()))
+        if (auto id = ast::as<ast::Ident>(ie->collection.get()))
         {
             std::string *ll = lookup_local_type(id->name);
 
             ParsedType pt = parse_type_chain(*ll);
 
-            if (struct_types.find(pt.base) != struct_types.end())
+            auto stIt = struct_types.find(ast::intern(pt.base));
+            if (stIt != struct_types.end())
             {
-                StructType *st = struct_types[pt.base];
+                StructType *st = stIt->second;
                 if (!st || st->isOpaque())
                 {
 
@@ -17,11 +17,11 @@ Value *CodeGen::codegen_assign(const ast::AssignStmt *as)
     if (!e)
         return nullptr;
 
-    if (auto ue = dynamic_cast<const ast::UnaryExpr *>(e))
+    if (auto ue = ast::as<ast::UnaryExpr>(e))
     {
         if (ue->op == "&")
         {
-            if (auto innerId = dynamic_cast<const ast::Ident *>(ue->rhs.get()))
+            if (auto innerId = ast::as<ast::Ident>(ue->rhs.get()))
             {
                 ptr = lookup_local(innerId->name);
                 if (!ptr)
@@ -30,7 +30,7 @@ Value *CodeGen::codegen_assign(const ast::AssignStmt *as)
                     return nullptr;
                 }
             }
-            else if (auto innerIe = dynamic_cast<const ast::IndexExpr *>(ue->rhs.get()))
+            else if (auto innerIe = ast::as<ast::IndexExpr>(ue->rhs.get()))
             {
                 ptr = codegen_index_addr(innerIe);
                 if (!ptr)
@@ -74,12 +74,12 @@ Value *CodeGen::codegen_assign(const ast::AssignStmt *as)
 
         else
         {
-            error("unsupported unary on LHS: " + ue->op);
+            error("unsupported unary on LHS: " + std::string(ue->op));
             return nullptr;
         }
     }
 
-    else if (auto me = dynamic_cast<const ast::MemberExpr *>(as->target.get()))
+    else if (auto me = ast::as<ast::MemberExpr>(as->target.get()))
     {
         Value *addr = codegen_member_addr(me);
         if (!addr)
@@ -196,7 +196,7 @@ Value *CodeGen::codegen_assign(const ast::AssignStmt *as)
         return rv;
     }
 
-    else if (auto id = dynamic_cast<const ast::Ident *>(e))
+    else if (auto id = ast::as<ast::Ident>(e))
     {
         ptr = lookup_local(id->name);
         if (!ptr)
@@ -204,7 +204,7 @@ Value *CodeGen::codegen_assign(const ast::AssignStmt *as)
             return nullptr;
         }
     }
-    else if (auto ie = dynamic_cast<const ast::IndexExpr *>(e))
+    else if (auto ie = ast::as<ast::IndexExpr>(e))
     {
         ptr = codegen_index_addr(ie);
         if (!ptr)
@@ -212,7 +212,7 @@ Value *CodeGen::codegen_assign(const ast::AssignStmt *as)
             return nullptr;
         }
     }
-    else if (auto sl = dynamic_cast<const ast::StructLiteral *>(e))
+    else if (auto sl = ast::as<ast::StructLiteral>(e))
     {
         ptr = codegen_struct_literal(sl);
         if (!ptr)
@@ -237,7 +237,7 @@ Value *CodeGen::codegen_assign(const ast::AssignStmt *as)
 
     if (auto *ai = dyn_cast<AllocaInst>(ptr))
     {
-        if (auto ue = dynamic_cast<const ast::UnaryExpr *>(e); ue && ue->op == "*")
+        if (auto ue = ast::as<ast::UnaryExpr>(e); ue && ue->op == "*")
         {
             pointeePtr = builder.CreateLoad(ai->getAllocatedType(), ai, "deref_load_ptr");
         }
@@ -249,7 +249,7 @@ Value *CodeGen::codegen_assign(const ast::AssignStmt *as)
     }
     else if (auto *gv = dyn_cast<GlobalVariable>(ptr))
     {
-        if (auto ue = dynamic_cast<const ast::UnaryExpr *>(e); ue && ue->op == "*")
+        if (auto ue = ast::as<ast::UnaryExpr>(e); ue && ue->op == "*")
         {
             pointeePtr = builder.CreateLoad(gv->getValueType(), gv, "deref_load_ptr");
         }
@@ -6,10 +6,13 @@
 #include <llvm/IR/GlobalVariable.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Passes/PassBuilder.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/ADT/SmallVector.h>
 #include <iostream>
+#include <algorithm>
 #include <cassert>
+#include <mutex>
 
 #include "fmt/printf.h"
 #include "fmt/println.h"
@@ -18,6 +21,7 @@
 #include "for/formula.h"
 #include "for/iter.h"
 #include "func/functions.h"
+#include "func/reach.h"
 #include "func/type.h"
 #include "if/if.h"
 #include "struct/struct.h"
@@ -37,17 +41,33 @@
 #include "array/append.h"
 #include "literal/literal.h"
 #include "postfix/postfix.h"
+#include "emit/bitcode.h"
+#include "emit/object.h"
+#include "emit/link.h"
+#include "emit/lto.h"
+#include "emit/jit.h"
 
 using namespace llvm;
 
 namespace codegen
 {
+    void initialize_native_target()
+    {
+        // Target registration is process-wide and not thread-safe; units
+        // generated in parallel each construct a CodeGen.
+        static std::once_flag native_init;
+        std::call_once(native_init, []
+                       {
+            InitializeNativeTarget();
+            InitializeNativeTargetAsmPrinter();
+            InitializeNativeTargetAsmParser(); });
+    }
+
     CodeGen::CodeGen(const std::string &module_name)
         : module(std::make_unique<Module>(module_name, context)), builder(context)
     {
-        InitializeNativeTarget();
-        InitializeNativeTargetAsmPrinter();
-        InitializeNativeTargetAsmParser();
+        initialize_native_target();
+        set_target({});
 
         Type *i8ptr = PointerType::get(Type::getInt8Ty(context), 0);
         FunctionType *printfType = FunctionType::get(IntegerType::getInt32Ty(context), {i8ptr}, true);
@@ -59,7 +79,10 @@ namespace codegen
     void CodeGen::error(const std::string &msg)
     {
         failed = true;
-        std::cerr << "[codegen error] " << msg << "\n";
+        if (error_handler)
+            error_handler(msg);
+        else
+            std::cerr << "[codegen error] " << msg << "\n";
     }
 
     llvm::Value *CodeGen::castToSameIntType(llvm::Value *v, llvm::Type *targetType)
@@ -94,48 +117,32 @@ namespace codegen
 
     void CodeGen::push_scope()
     {
-        locals_stack_type.emplace_back();
-        locals_stack.emplace_back();
+        locals.push();
     }
     
     void CodeGen::pop_scope()
     {
-        if (!locals_stack.empty())
-            locals_stack.pop_back();
-        if (!locals_stack_type.empty())
-            locals_stack_type.pop_back();
+        locals.pop();
     }
 
-    void CodeGen::bind_local(const std::string &name, const std::string type, Value *v)
+    void CodeGen::bind_local(ast::Symbol name, const std::string type, Value *v)
     {
-        if (locals_stack.empty() || locals_stack_type.empty())
+        if (locals.depth() == 0)
             push_scope();
-        locals_stack.back()[name] = v;
-        locals_stack_type.back()[name] = type;
+        locals.bind(name, v, type);
     }
 
-    std::string *CodeGen::lookup_local_type(const std::string &name)
+    std::string *CodeGen::lookup_local_type(ast::Symbol name)
     {
-        for (int i = (int)locals_stack_type.size() - 1; i >= 0; --i)
-        {
-            auto &m = locals_stack_type[i];
-            auto it = m.find(name);
-            if (it != m.end())
-                return &it->second;
-        }
-
+        if (auto *b = locals.lookup(name))
+            return &b->type;
         return nullptr;
     }
 
-    Value *CodeGen::lookup_local(const std::string &name)
+    Value *CodeGen::lookup_local(ast::Symbol name)
     {
-        for (int i = (int)locals_stack.size() - 1; i >= 0; --i)
-        {
-            auto &m = locals_stack[i];
-            auto it = m.find(name);
-            if (it != m.end())
-                return it->second;
-        }
+        if (auto *b = locals.lookup(name))
+            return b->value;
 
         auto fIt = function_protos.find(name);
         if (fIt != function_protos.end())
@@ -147,31 +154,34 @@ namespace codegen
     {
         if (!e)
             return nullptr;
-        if (auto lit = dynamic_cast<const ast::Literal *>(e))
-            return codegen_literal(lit);
-        if (auto id = dynamic_cast<const ast::Ident *>(e))
-            return codegen_ident(id);
-        if (auto ue = dynamic_cast<const ast::UnaryExpr *>(e))
-            return codegen_unary(ue);
-        if (auto be = dynamic_cast<const ast::BinaryExpr *>(e))
-            return codegen_binary(be);
-        if (auto ce = dynamic_cast<const ast::CallExpr *>(e))
-            return codegen_call(ce);
-        if (auto alit = dynamic_cast<const ast::ArrayLiteral *>(e))
-            return codegen_array(alit);
-        if (auto sl = dynamic_cast<const ast::StructLiteral *>(e))
-            return codegen_struct_literal(sl);
-        if (auto me = dynamic_cast<const ast::MemberExpr *>(e))
-            return codegen_member(me);
-        if (auto bal = dynamic_cast<const ast::ByteArrayLiteral *>(e))
-            return codegen_byte_array(bal);
-        if (auto pe = dynamic_cast<const ast::PostfixExpr *>(e))
-            return codegen_postfix(pe);
-        if (auto ie = dynamic_cast<const ast::IndexExpr *>(e))
-            return codegen_index(ie);
-        else
+        switch (e->kind)
+        {
+        case ast::NodeKind::Literal:
+            return codegen_literal(static_cast<const ast::Literal *>(e));
+        case ast::NodeKind::Ident:
+            return codegen_ident(static_cast<const ast::Ident *>(e));
+        case ast::NodeKind::UnaryExpr:
+            return codegen_unary(static_cast<const ast::UnaryExpr *>(e));
+        case ast::NodeKind::BinaryExpr:
+            return codegen_binary(static_cast<const ast::BinaryExpr *>(e));
+        case ast::NodeKind::CallExpr:
+            return codegen_call(static_cast<const ast::CallExpr *>(e));
+        case ast::NodeKind::ArrayLiteral:
+            return codegen_array(static_cast<const ast::ArrayLiteral *>(e));
+        case ast::NodeKind::StructLiteral:
+            return codegen_struct_literal(static_cast<const ast::StructLiteral *>(e));
+        case ast::NodeKind::MemberExpr:
+            return codegen_member(static_cast<const ast::MemberExpr *>(e));
+        case ast::NodeKind::ByteArrayLiteral:
+            return codegen_byte_array(static_cast<const ast::ByteArrayLiteral *>(e));
+        case ast::NodeKind::PostfixExpr:
+            return codegen_postfix(static_cast<const ast::PostfixExpr *>(e));
+        case ast::NodeKind::IndexExpr:
+            return codegen_index(static_cast<const ast::IndexExpr *>(e));
+        default:
             error("unhandled expr node");
-        return nullptr;
+            return nullptr;
+        }
     }
 
     Value *CodeGen::codegen_block(const ast::BlockStmt *blk)
@@ -187,12 +197,14 @@ namespace codegen
     {
         if (!s)
             return nullptr;
-        if (auto es = dynamic_cast<const ast::ExprStmt *>(s))
+        switch (s->kind)
         {
-            return codegen_expr(es->expr.get());
-        }
-        if (auto rs = dynamic_cast<const ast::ReturnStmt *>(s))
+        case ast::NodeKind::ExprStmt:
+            return codegen_expr(static_cast<const ast::ExprStmt *>(s)->expr.get());
+
+        case ast::NodeKind::ReturnStmt:
         {
+            auto rs = static_cast<const ast::ReturnStmt *>(s);
             Value *rv = nullptr;
             if (rs->expr)
                 rv = codegen_expr(rs->expr.get());
@@ -202,22 +214,17 @@ namespace codegen
                 builder.CreateRet(rv);
             return nullptr;
         }
-        if (auto vd = dynamic_cast<const ast::VarDecl *>(s))
-        {
-            return codegen_vardecl(vd);
-        }
 
-        if (auto as = dynamic_cast<const ast::AssignStmt *>(s))
-        {
-            return codegen_assign(as);
-        }
+        case ast::NodeKind::VarDecl:
+            return codegen_vardecl(static_cast<const ast::VarDecl *>(s));
 
-        if (auto ifs = dynamic_cast<const ast::IfStmt *>(s))
-        {
-            return codegen_ifstmt(ifs);
-        }
+        case ast::NodeKind::AssignStmt:
+            return codegen_assign(static_cast<const ast::AssignStmt *>(s));
 
-        if (auto bs = dynamic_cast<const ast::BreakStmt *>(s))
+        case ast::NodeKind::IfStmt:
+            return codegen_ifstmt(static_cast<const ast::IfStmt *>(s));
+
+        case ast::NodeKind::BreakStmt:
         {
             if (break_targets.empty())
             {
@@ -232,7 +239,7 @@ namespace codegen
             return nullptr;
         }
 
-        if (auto cs = dynamic_cast<const ast::ContinueStmt *>(s))
+        case ast::NodeKind::ContinueStmt:
         {
             if (continue_targets.empty())
             {
@@ -246,65 +253,131 @@ namespace codegen
             return nullptr;
         }
 
-        if (auto fs = dynamic_cast<const ast::ForInStmt *>(s))
-        {
-            return codegen_forinstmt(fs);
-        }
+        case ast::NodeKind::ForInStmt:
+            return codegen_forinstmt(static_cast<const ast::ForInStmt *>(s));
 
-        if (auto fcs = dynamic_cast<const ast::ForCStyleStmt *>(s))
-        {
-            return codegen_forcstmt(fcs);
-        }
+        case ast::NodeKind::ForCStyleStmt:
+            return codegen_forcstmt(static_cast<const ast::ForCStyleStmt *>(s));
 
-        if (auto fs2 = dynamic_cast<const ast::ForStmt *>(s))
-        {
-            return codegen_forstmt(fs2);
+        case ast::NodeKind::ForStmt:
+            return codegen_forstmt(static_cast<const ast::ForStmt *>(s));
+
+        default:
+            error("unhandled stmt type in codegen");
+            return nullptr;
         }
+    }
 
-        error("unhandled stmt type in codegen");
-        return nullptr;
+    std::string CodeGen::symbol_name(const ast::FuncDecl *fd) const
+    {
+        if (symbol_prefix.empty() || fd->is_pub || fd->name == "main")
+            return fd->name.str();
+        return symbol_prefix + fd->name;
     }
 
-    bool CodeGen::generate(const ast::Program &prog)
+    bool CodeGen::generate(const ast::Program &prog, const std::vector<const ast::FuncDecl *> &externs)
     {
         failed = false;
 
         prepare_struct_types(prog);
 
         std::vector<const ast::FuncDecl *> funcPtrs;
+        size_t top_level_stmts = 0;
         for (const auto &d : prog.decls)
         {
-            if (auto fd = dynamic_cast<const ast::FuncDecl *>(d.get()))
+            switch (d->kind)
             {
-                funcPtrs.push_back(fd);
+            case ast::NodeKind::FuncDecl:
+                funcPtrs.push_back(static_cast<const ast::FuncDecl *>(d.get()));
+                break;
+            case ast::NodeKind::StmtDecl:
+                ++top_level_stmts;
+                break;
+            default:
+                break;
             }
         }
+        // Skipped bodies are parsed only for functions the program can call.
+        if (std::any_of(funcPtrs.begin(), funcPtrs.end(), [](const ast::FuncDecl *fd)
+                        { return fd->body_pending(); }))
+            funcPtrs = reachable_functions(funcPtrs);
         if (!funcPtrs.empty())
             predeclare_functions(funcPtrs);
+        if (!externs.empty())
+            predeclare_functions(externs);
 
-        for (const auto &d : prog.decls)
+        for (const ast::FuncDecl *fd : funcPtrs)
+            codegen_function_decl(fd);
+
+        for (size_t i = 0; i < top_level_stmts; ++i)
+            error("top-level statements are not supported in codegen (please define fn main)");
+
+        std::string problems;
+        raw_string_ostream problems_os(problems);
+        if (verifyModule(*module, &problems_os))
         {
-            if (auto fd = dynamic_cast<const ast::FuncDecl *>(d.get()))
-            {
-                codegen_function_decl(fd);
-            }
+            error("module verification failed: " + StringRef(problems_os.str()).trim().str());
+            return false;
         }
 
-        for (const auto &d : prog.decls)
+        return !failed;
+    }
+
+    void CodeGen::optimize(OptLevel level, bool thin_prelink)
+    {
+        OptimizationLevel ol;
+        switch (level)
         {
-            if (auto sd = dynamic_cast<const ast::StmtDecl *>(d.get()))
-            {
-                error("top-level statements are not supported in codegen (please define fn main)");
-            }
+        case OptLevel::O0:
+            return;
+        case OptLevel::O1:
+            ol = OptimizationLevel::O1;
+            break;
+        case OptLevel::O2:
+            ol = OptimizationLevel::O2;
+            break;
+        case OptLevel::O3:
+            ol = OptimizationLevel::O3;
+            break;
+        case OptLevel::Os:
+            ol = OptimizationLevel::Os;
+            break;
+        case OptLevel::Oz:
+            ol = OptimizationLevel::Oz;
+            break;
         }
 
-        if (verifyModule(*module, &errs()))
+        // The ThinLTO backends only know levels 0-3 (see thin_link), so size
+        // optimization is carried to them on the functions themselves.
+        if (thin_prelink && (level == OptLevel::Os || level == OptLevel::Oz))
         {
-            error("module verification failed");
-            return false;
+            for (Function &F : *module)
+            {
+                if (F.isDeclaration())
+                    continue;
+                F.addFnAttr(Attribute::OptimizeForSize);
+                if (level == OptLevel::Oz)
+                    F.addFnAttr(Attribute::MinSize);
+            }
         }
 
-        return !failed;
+        LoopAnalysisManager LAM;
+        FunctionAnalysisManager FAM;
+        CGSCCAnalysisManager CGAM;
+        ModuleAnalysisManager MAM;
+
+        // With the target machine the cost models see the real CPU, so the
+        // vectorizers can use its vector width.
+        PassBuilder PB(target_machine.get());
+        PB.registerModuleAnalyses(MAM);
+        PB.registerCGSCCAnalyses(CGAM);
+        PB.registerFunctionAnalyses(FAM);
+        PB.registerLoopAnalyses(LAM);
+        PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+        ModulePassManager MPM = thin_prelink ? PB.buildThinLTOPreLinkDefaultPipeline(ol)
+                                             : PB.buildPerModuleDefaultPipeline(ol);
+        MPM.run(*module, MAM);
     }
 
     void CodeGen::dump_llvm_ir()
@@ -319,7 +392,7 @@ namespace codegen
         raw_fd_ostream dest(path, EC, sys::fs::OF_None);
         if (EC)
         {
-            std::cerr << "Could not open file: " << EC.message() << "\n";
+            error("could not open " + path + ": " + EC.message());
             return false;
         }
         module->print(dest, nullptr);
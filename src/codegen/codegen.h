@@ -1,18 +1,55 @@
 #pragma once
 #include "../ast/ast.h"
+#include "scope.h"
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Support/MemoryBufferRef.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/raw_ostream.h>
-#include <map>
+#include <llvm/Target/TargetMachine.h>
+#include <functional>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+namespace llvm::orc
+{
+    class LLJIT;
+}
+
 namespace codegen
 {
+    class JITObjectCache;
+
+
+    enum class OptLevel
+    {
+        O0,
+        O1,
+        O2,
+        O3,
+        Os,
+        Oz,
+    };
+
+    // What the module is compiled for. Empty fields mean the host triple,
+    // the generic CPU and no extra features; cpu "native" selects the host
+    // CPU together with every feature it reports.
+    struct TargetConfig
+    {
+        std::string triple;
+        std::string cpu;
+        std::string features;
+    };
+
+    // Registers the host target with LLVM. Runs once per process; every
+    // CodeGen calls it, and so must anything that drives LLVM before one
+    // exists.
+    void initialize_native_target();
 
     class CodeGen
     {
@@ -20,55 +57,145 @@ namespace codegen
         CodeGen(const std::string &module_name = "module");
         ~CodeGen();
 
-        bool generate(const ast::Program &prog);
+        // `externs` are functions defined in other compilation units; they
+        // are declared so calls resolve, and their bodies are not generated.
+        bool generate(const ast::Program &prog, const std::vector<const ast::FuncDecl *> &externs = {});
+
+        // Prefix for the symbols of non-public functions, so units compiled
+        // separately cannot collide once linked (e.g. "math.").
+        void set_symbol_prefix(const std::string &prefix) { symbol_prefix = prefix; }
+
+        // Receives codegen errors instead of stderr.
+        void set_error_handler(std::function<void(const std::string &)> handler) { error_handler = std::move(handler); }
+
+        // Traces variable declarations and type lookups to stdout.
+        void set_debug(bool on) { irdebug = on; }
+
+        // Creates the target machine and stamps the module with its triple and
+        // DataLayout. The constructor sets up the host target; call this
+        // before generate() to compile for something else.
+        bool set_target(const TargetConfig &cfg);
+
+        // Runs LLVM's default pipeline for `level` over the generated module.
+        // O0 leaves the module untouched. `thin_prelink` runs the ThinLTO
+        // pre-link pipeline instead, leaving cross-module work to thin_link.
+        void optimize(OptLevel level, bool thin_prelink = false);
 
         void dump_llvm_ir();
 
         bool write_ir_to_file(const std::string &path);
+        bool write_bitcode_to_file(const std::string &path);
+
+        // Bitcode with a ThinLTO summary attached, ready for thin_link.
+        void write_thin_bitcode(llvm::SmallVectorImpl<char> &out);
+
+        // Links a precompiled bitcode module into this one. Call after
+        // generate() and before optimize().
+        bool link_bitcode_file(const std::string &path);
+
+        // Moves another unit's module into this one. The units have separate
+        // contexts, so the module travels as in-memory bitcode.
+        bool link_module(CodeGen &other);
+
+        // Lowers the module for the configured target and writes an object
+        // file, or assembly text when `assembly` is set.
+        bool write_native_file(const std::string &path, bool assembly = false);
+        bool write_native_object(llvm::SmallVectorImpl<char> &out);
+
+        // Splits the module into one partition per path and lowers the
+        // partitions on that many threads. Link all the outputs together.
+        bool write_native_files(const std::vector<std::string> &paths, bool assembly = false);
+
+        // Makes jit_compile load and store objects in `dir`. `salt` is folded
+        // into the cache key next to the module itself and the host; it must
+        // identify the compiler build (module::compiler_id()) plus anything
+        // the module does not capture, such as a hash of the sources.
+        void set_jit_cache(const std::string &dir, const std::string &salt);
+
+        // True when the last jit_compile loaded everything from the cache.
+        bool jit_cache_hit() const;
+
+        // Compiles a copy of the module in-process with ORC LLJIT and looks
+        // up main. Declared-only symbols (libc, the FFI table) resolve
+        // against this process. `tiered` starts every function at O0 and
+        // recompiles hot ones at O3 on a background thread.
+        bool jit_compile(bool tiered = false);
+
+        // Calls the JIT-compiled main with `args` as argv[1..] and returns
+        // its exit code.
+        int jit_run(const std::vector<std::string> &args);
+
+        // Functions swapped to their O3 version so far by a tiered JIT.
+        size_t jit_promoted() const;
 
         llvm::Module *get_module() { return module.get(); }
 
+        // A copy of the module in `ctx`, which the caller owns (LLJIT, for
+        // one, insists on owning the context of what it is given). The copy
+        // goes through bitcode; `bitcode`, if given, receives it.
+        std::unique_ptr<llvm::Module> copy_module(llvm::LLVMContext &ctx,
+                                                  llvm::SmallVectorImpl<char> *bitcode = nullptr);
+
     private:
         llvm::LLVMContext context;
         std::unique_ptr<llvm::Module> module;
         llvm::IRBuilder<> builder;
+        std::unique_ptr<llvm::TargetMachine> target_machine;
+
+        std::unique_ptr<JITObjectCache> jit_cache;
+        std::string jit_cache_salt;
+        std::unique_ptr<llvm::orc::LLJIT> jit;
+        int (*jit_main)(int, char **) = nullptr;
+        bool jit_main_void = false;
+
+        // Declared after `jit` so its compile thread stops before the JIT
+        // goes away.
+        struct Tiering;
+        std::unique_ptr<Tiering> tiering;
+        bool jit_add_tiered(std::unique_ptr<llvm::Module> m, std::unique_ptr<llvm::LLVMContext> ctx);
 
         int g_byte_array_counter = 0;
 
         bool irdebug = false;
+        std::function<void(const std::string &)> error_handler;
+
+        std::string symbol_prefix;
+        std::string symbol_name(const ast::FuncDecl *fd) const;
+
+        bool link_bitcode(llvm::MemoryBufferRef buf, const std::string &name);
+        bool emit_native(llvm::raw_pwrite_stream &dest, bool assembly);
 
-        std::vector<std::map<std::string, llvm::Value *>> locals_stack;
-        std::vector<std::map<std::string, std::string>> locals_stack_type;
+        ScopeTable locals;
         std::unordered_map<std::string, llvm::Type *> localPointedType;
         std::unordered_map<std::string, llvm::Type *> globalPointedType;
 
-        std::map<std::string, llvm::Function *> function_protos;
+        std::unordered_map<ast::Symbol, llvm::Function *> function_protos;
 
         std::vector<llvm::BasicBlock *> break_targets;
         std::vector<llvm::BasicBlock *> continue_targets;
 
         llvm::FunctionCallee printf_fn;
 
-        std::unordered_map<std::string, llvm::StructType *> struct_types;
-        std::unordered_map<std::string, const ast::StructDecl *> struct_decls;
+        std::unordered_map<ast::Symbol, llvm::StructType *> struct_types;
+        std::unordered_map<ast::Symbol, const ast::StructDecl *> struct_decls;
 
-        llvm::StructType *lookup_struct_type(const std::string &name);
+        llvm::StructType *lookup_struct_type(ast::Symbol name);
 
-        std::pair<llvm::StructType *, llvm::Value *> resolve_struct_and_ptr(llvm::Value *v, const std::string &hintVarName);
-        std::pair<llvm::StructType *, llvm::Value *> deduce_struct_type_and_ptr(llvm::Value *v, const std::string &hintVarName);
+        std::pair<llvm::StructType *, llvm::Value *> resolve_struct_and_ptr(llvm::Value *v, ast::Symbol hintVarName);
+        std::pair<llvm::StructType *, llvm::Value *> deduce_struct_type_and_ptr(llvm::Value *v, ast::Symbol hintVarName);
 
         void prepare_struct_types(const ast::Program &prog);
         llvm::Type *resolve_type_by_name(const std::string &typeName);
         llvm::Type *resolve_type_from_ast_local(const ast::Type *at);
-        llvm::StructType *get_or_create_named_struct(const std::string &name);
+        llvm::StructType *get_or_create_named_struct(ast::Symbol name);
         llvm::StructType *build_struct_type_from_decl(const ast::StructDecl *sd);
 
         llvm::Value *codegen_struct_literal(const ast::StructLiteral *sl);
         llvm::Value *codegen_member(const ast::MemberExpr *me);
         llvm::Value *codegen_member_addr(const ast::MemberExpr *me);
-        int get_field_index(const ast::StructDecl *sd, const std::string &fieldName);
+        int get_field_index(const ast::StructDecl *sd, ast::Symbol fieldName);
 
-        llvm::StructType *get_struct_type_from_value(llvm::Value *v, const std::string &varname);
+        llvm::StructType *get_struct_type_from_value(llvm::Value *v, ast::Symbol varname);
 
         llvm::Type *get_int_type();
         llvm::Type *get_i64_type();
@@ -123,15 +250,39 @@ namespace codegen
         llvm::Value *make_global_string(const std::string &str, const std::string &name = "");
         void push_scope();
         void pop_scope();
-        void bind_local(const std::string &name, const std::string type, llvm::Value *v);
-        llvm::Value *lookup_local(const std::string &name);
+        void bind_local(ast::Symbol name, const std::string type, llvm::Value *v);
+        llvm::Value *lookup_local(ast::Symbol name);
         llvm::Type *getLLVMType(const std::string &typeName);
-        std::string *lookup_local_type(const std::string &name);
+        std::string *lookup_local_type(ast::Symbol name);
 
         void predeclare_functions(const std::vector<const ast::FuncDecl *> &funcs);
+        std::vector<const ast::FuncDecl *> reachable_functions(const std::vector<const ast::FuncDecl *> &funcs);
         void register_builtin_ffi();
 
         void error(const std::string &msg);
         bool failed = false;
     };
+
+    struct ThinModule
+    {
+        std::string name;
+        llvm::SmallVector<char, 0> bitcode;
+    };
+
+    // Runs the ThinLTO thin link over the summaries and the per-module
+    // backends on up to `jobs` threads, writing one object per module into
+    // `output_dir`. The object paths are appended to `objects`.
+    bool thin_link(const std::vector<ThinModule> &modules,
+                   const TargetConfig &target,
+                   OptLevel level,
+                   unsigned jobs,
+                   const std::string &output_dir,
+                   std::vector<std::string> &objects,
+                   std::string &err);
+
+    // Links object files into an executable with the system compiler driver.
+    bool link_executable(const std::vector<std::string> &objects,
+                         const std::string &output,
+                         const std::vector<std::string> &extra_args,
+                         std::string &err);
 }
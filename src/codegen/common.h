@@ -19,19 +19,20 @@ namespace codegen
             return llvm::IntegerType::get(context, 64);
         }
 
+        // Looked up by name rather than cached in a static: each CodeGen has
+        // its own context, and several may be generating at once.
         inline llvm::StructType *getOrCreateArrayStruct(llvm::LLVMContext &context)
         {
-            static llvm::StructType *cached = nullptr;
-            if (cached)
-                return cached;
+            if (auto *st = llvm::StructType::getTypeByName(context, "Array_internal"))
+                return st;
 
-            cached = llvm::StructType::create(context, "Array_internal");
-            cached->setBody(
+            auto *st = llvm::StructType::create(context, "Array_internal");
+            st->setBody(
                 getI8PtrTy(context),
                 getI64Ty(context),
                 getI64Ty(context),
                 getI64Ty(context));
-            return cached;
+            return st;
         }
 
         inline llvm::Value *constInt64(llvm::IRBuilder<> &B, uint64_t v)
@@ -0,0 +1,71 @@
+#pragma once
+#include "../codegen.h"
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+using namespace llvm;
+using namespace codegen;
+
+bool CodeGen::write_bitcode_to_file(const std::string &path)
+{
+    std::error_code EC;
+    raw_fd_ostream dest(path, EC, sys::fs::OF_None);
+    if (EC)
+    {
+        error("could not open " + path + ": " + EC.message());
+        return false;
+    }
+    WriteBitcodeToFile(*module, dest);
+    return true;
+}
+
+bool CodeGen::link_bitcode(MemoryBufferRef buf, const std::string &name)
+{
+    auto parsed = parseBitcodeFile(buf, context);
+    if (!parsed)
+    {
+        error("invalid bitcode in " + name + ": " + toString(parsed.takeError()));
+        return false;
+    }
+
+    std::unique_ptr<Module> other = std::move(*parsed);
+    if (other->getTargetTriple().empty())
+        other->setTargetTriple(module->getTargetTriple());
+    if (other->getDataLayout().isDefault())
+        other->setDataLayout(module->getDataLayout());
+
+    // linkModules reports through the context's diagnostic handler and
+    // returns true on error.
+    if (Linker::linkModules(*module, std::move(other)))
+    {
+        error("failed to link " + name);
+        return false;
+    }
+    return true;
+}
+
+bool CodeGen::link_bitcode_file(const std::string &path)
+{
+    auto buf = MemoryBuffer::getFile(path);
+    if (!buf)
+    {
+        error("could not read " + path + ": " + buf.getError().message());
+        return false;
+    }
+    return link_bitcode((*buf)->getMemBufferRef(), path);
+}
+
+bool CodeGen::link_module(CodeGen &other)
+{
+    SmallVector<char, 0> bytes;
+    {
+        raw_svector_ostream os(bytes);
+        WriteBitcodeToFile(*other.module, os);
+    }
+    std::string name = other.module->getModuleIdentifier();
+    return link_bitcode(MemoryBufferRef(StringRef(bytes.data(), bytes.size()), name), name);
+}
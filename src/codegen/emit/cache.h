@@ -0,0 +1,74 @@
+#pragma once
+#include "../codegen.h"
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+#include <atomic>
+
+using namespace llvm;
+
+namespace codegen
+{
+    // Compiled JIT objects on disk, one <dir>/<key>.o per module. The key is
+    // the module identifier, which jit_compile sets to a hash of everything
+    // that can change the object.
+    class JITObjectCache : public ObjectCache
+    {
+    public:
+        explicit JITObjectCache(std::string dir) : dir_(std::move(dir)) {}
+
+        void notifyObjectCompiled(const Module *m, MemoryBufferRef obj) override
+        {
+            if (sys::fs::create_directories(dir_))
+                return;
+
+            // Written under a private name and renamed into place, so a
+            // concurrent run never loads half an object.
+            std::string path = object_path(m);
+            std::string tmp = path + "." + std::to_string(sys::Process::getProcessId()) + ".tmp";
+            std::error_code ec;
+            raw_fd_ostream os(tmp, ec, sys::fs::OF_None);
+            if (ec)
+                return;
+            os << obj.getBuffer();
+            os.close();
+            if (os.has_error())
+            {
+                os.clear_error();
+                sys::fs::remove(tmp);
+                return;
+            }
+            if (sys::fs::rename(tmp, path))
+                sys::fs::remove(tmp);
+        }
+
+        std::unique_ptr<MemoryBuffer> getObject(const Module *m) override
+        {
+            auto buf = MemoryBuffer::getFile(object_path(m));
+            if (!buf)
+            {
+                ++misses_;
+                return nullptr;
+            }
+            ++hits_;
+            return std::move(*buf);
+        }
+
+        size_t hits() const { return hits_; }
+        size_t misses() const { return misses_; }
+
+    private:
+        std::string dir_;
+        std::atomic<size_t> hits_{0};
+        std::atomic<size_t> misses_{0};
+
+        std::string object_path(const Module *m) const
+        {
+            SmallString<128> path(dir_);
+            sys::path::append(path, m->getModuleIdentifier() + ".o");
+            return std::string(path);
+        }
+    };
+}
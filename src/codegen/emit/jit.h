@@ -0,0 +1,144 @@
+#pragma once
+#include "../codegen.h"
+#include "cache.h"
+#include "tiered.h"
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/TargetProcess/TargetExecutionUtils.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/TargetParser/Host.h>
+#include <iostream>
+
+using namespace llvm;
+using namespace codegen;
+
+void CodeGen::set_jit_cache(const std::string &dir, const std::string &salt)
+{
+    jit_cache = std::make_unique<JITObjectCache>(dir);
+    jit_cache_salt = salt;
+}
+
+bool CodeGen::jit_cache_hit() const
+{
+    return jit_cache && jit_cache->hits() > 0 && jit_cache->misses() == 0;
+}
+
+std::unique_ptr<Module> CodeGen::copy_module(LLVMContext &ctx, SmallVectorImpl<char> *bitcode)
+{
+    SmallVector<char, 0> local;
+    SmallVectorImpl<char> &buf = bitcode ? *bitcode : local;
+    buf.clear();
+    raw_svector_ostream os(buf);
+    WriteBitcodeToFile(*module, os);
+
+    auto copy = parseBitcodeFile(MemoryBufferRef(StringRef(buf.data(), buf.size()), module->getModuleIdentifier()), ctx);
+    if (!copy)
+    {
+        error("copy module: " + toString(copy.takeError()));
+        return nullptr;
+    }
+    return std::move(*copy);
+}
+
+bool CodeGen::jit_compile(bool tiered)
+{
+    Function *main_fn = module->getFunction("main");
+    if (!main_fn || main_fn->isDeclaration())
+    {
+        error("no main function to run");
+        return false;
+    }
+    jit_main_void = main_fn->getReturnType()->isVoidTy();
+
+    // LLJIT owns the context of every module it is given, and ours belongs
+    // to CodeGen. The bitcode of the copy doubles as the cache key input.
+    SmallVector<char, 0> buf;
+    auto ctx = std::make_unique<LLVMContext>();
+    auto copy = copy_module(*ctx, &buf);
+    if (!copy)
+        return false;
+
+    orc::LLJITBuilder builder;
+    if (jit_cache && !tiered)
+    {
+        // The object depends on the IR, the host it is compiled for and the
+        // compiler that built it; the salt carries the compiler's identity.
+        SHA1 key;
+        key.update(StringRef(buf.data(), buf.size()));
+        key.update(jit_cache_salt);
+        key.update(sys::getProcessTriple());
+        key.update(sys::getHostCPUName());
+        copy->setModuleIdentifier(toHex(key.final(), true));
+
+        JITObjectCache *cache = jit_cache.get();
+        builder.setCompileFunctionCreator([cache](orc::JITTargetMachineBuilder jtmb)
+                                          -> Expected<std::unique_ptr<orc::IRCompileLayer::IRCompiler>>
+                                          {
+            auto tm = jtmb.createTargetMachine();
+            if (!tm)
+                return tm.takeError();
+            return std::make_unique<orc::TMOwningSimpleCompiler>(std::move(*tm), cache); });
+    }
+    else if (tiered)
+    {
+        // One compiler for both tiers: baseline modules get FastISel at
+        // CodeGenOptLevel::None, recompiled ones the full backend.
+        builder.setCompileFunctionCreator([](orc::JITTargetMachineBuilder jtmb)
+                                          -> Expected<std::unique_ptr<orc::IRCompileLayer::IRCompiler>>
+                                          { return std::make_unique<TieredCompiler>(std::move(jtmb)); });
+    }
+    auto created = builder.create();
+    if (!created)
+    {
+        error("jit: " + toString(created.takeError()));
+        return false;
+    }
+    jit = std::move(*created);
+
+    auto host = orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(jit->getDataLayout().getGlobalPrefix());
+    if (!host)
+    {
+        error("jit: " + toString(host.takeError()));
+        return false;
+    }
+    jit->getMainJITDylib().addGenerator(std::move(*host));
+
+    if (tiered)
+    {
+        if (!jit_add_tiered(std::move(copy), std::move(ctx)))
+            return false;
+    }
+    else if (Error e = jit->addIRModule(orc::ThreadSafeModule(std::move(copy), std::move(ctx))))
+    {
+        error("jit: " + toString(std::move(e)));
+        return false;
+    }
+
+    // The lookup is what compiles the module.
+    auto sym = jit->lookup("main");
+    if (!sym)
+    {
+        error("jit: " + toString(sym.takeError()));
+        return false;
+    }
+    jit_main = sym->toPtr<int (*)(int, char **)>();
+    return true;
+}
+
+int CodeGen::jit_run(const std::vector<std::string> &args)
+{
+    if (!jit_main)
+        return 1;
+    // Program output goes through the same stdio as ours.
+    std::cout.flush();
+    outs().flush();
+    if (jit_main_void)
+    {
+        reinterpret_cast<void (*)()>(jit_main)();
+        return 0;
+    }
+    return orc::runAsMain(jit_main, args, module->getModuleIdentifier());
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "../codegen.h"
+#include <llvm/Support/Program.h>
+#include <cstdlib>
+
+namespace codegen
+{
+    // Links with the system compiler driver, which knows where the C runtime
+    // and startup objects live. $CC overrides the search for clang/cc.
+    bool link_executable(const std::vector<std::string> &objects,
+                         const std::string &output,
+                         const std::vector<std::string> &extra_args,
+                         std::string &err)
+    {
+        std::string driver;
+        if (const char *cc = std::getenv("CC"); cc && *cc)
+        {
+            auto found = llvm::sys::findProgramByName(cc);
+            if (!found)
+            {
+                err = std::string("linker not found: ") + cc;
+                return false;
+            }
+            driver = *found;
+        }
+        else
+        {
+            for (const char *name : {"clang", "cc"})
+            {
+                if (auto found = llvm::sys::findProgramByName(name))
+                {
+                    driver = *found;
+                    break;
+                }
+            }
+            if (driver.empty())
+            {
+                err = "no linker found (tried clang, cc; set CC to override)";
+                return false;
+            }
+        }
+
+        std::vector<llvm::StringRef> argv;
+        argv.push_back(driver);
+        for (const auto &o : objects)
+            argv.push_back(o);
+        argv.push_back("-o");
+        argv.push_back(output);
+        for (const auto &a : extra_args)
+            argv.push_back(a);
+
+        std::string msg;
+        int rc = llvm::sys::ExecuteAndWait(driver, argv, std::nullopt, {}, 0, 0, &msg);
+        if (rc != 0)
+        {
+            err = msg.empty() ? driver + " exited with status " + std::to_string(rc) : msg;
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include "../codegen.h"
+#include <llvm/Analysis/ModuleSummaryAnalysis.h>
+#include <llvm/Analysis/ProfileSummaryInfo.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/LTO/LTO.h>
+#include <llvm/Support/Caching.h>
+#include <llvm/Support/Threading.h>
+#include <filesystem>
+#include <unordered_set>
+
+using namespace llvm;
+using namespace codegen;
+
+void CodeGen::write_thin_bitcode(SmallVectorImpl<char> &out)
+{
+    ProfileSummaryInfo psi(*module);
+    ModuleSummaryIndex index = buildModuleSummaryIndex(*module, nullptr, &psi);
+    raw_svector_ostream os(out);
+    WriteBitcodeToFile(*module, os, false, &index, true);
+}
+
+namespace codegen
+{
+    bool thin_link(const std::vector<ThinModule> &modules,
+                   const TargetConfig &target,
+                   OptLevel level,
+                   unsigned jobs,
+                   const std::string &output_dir,
+                   std::vector<std::string> &objects,
+                   std::string &err)
+    {
+        lto::Config conf;
+        SubtargetFeatures features;
+        resolve_cpu_features(target, conf.CPU, features);
+        conf.MAttrs = features.getFeatures();
+        conf.RelocModel = Reloc::PIC_;
+        conf.DefaultTriple = target.triple.empty() ? sys::getDefaultTargetTriple() : Triple::normalize(target.triple);
+        switch (level)
+        {
+        case OptLevel::O0:
+            conf.OptLevel = 0;
+            conf.CGOptLevel = CodeGenOptLevel::None;
+            break;
+        case OptLevel::O1:
+            conf.OptLevel = 1;
+            conf.CGOptLevel = CodeGenOptLevel::Less;
+            break;
+        case OptLevel::O2:
+            conf.OptLevel = 2;
+            conf.CGOptLevel = CodeGenOptLevel::Default;
+            break;
+        case OptLevel::O3:
+            conf.OptLevel = 3;
+            conf.CGOptLevel = CodeGenOptLevel::Aggressive;
+            break;
+        case OptLevel::Os:
+        case OptLevel::Oz:
+            // lto::Config has no size levels. The pre-link step marked every
+            // function optsize (and minsize for -Oz), which the -O2 backend
+            // pipeline and codegen honor, as with clang -Os -flto=thin.
+            conf.OptLevel = 2;
+            conf.CGOptLevel = CodeGenOptLevel::Default;
+            break;
+        }
+
+        lto::LTO lto(std::move(conf), lto::createInProcessThinBackend(heavyweight_hardware_concurrency(jobs)));
+
+        // Every module is ours, so each defined symbol has exactly one
+        // definition. Public functions stay visible to regular objects since
+        // --link-arg may bring in C code that calls them.
+        std::unordered_set<std::string> defined;
+        for (const auto &m : modules)
+        {
+            auto input = lto::InputFile::create(MemoryBufferRef(StringRef(m.bitcode.data(), m.bitcode.size()), m.name));
+            if (!input)
+            {
+                err = m.name + ": " + toString(input.takeError());
+                return false;
+            }
+
+            std::vector<lto::SymbolResolution> res;
+            for (const auto &sym : (*input)->symbols())
+            {
+                lto::SymbolResolution r;
+                if (!sym.isUndefined())
+                {
+                    r.Prevailing = defined.insert(sym.getName().str()).second;
+                    r.FinalDefinitionInLinkageUnit = true;
+                    r.VisibleToRegularObj = true;
+                }
+                res.push_back(r);
+            }
+
+            if (Error e = lto.add(std::move(*input), res))
+            {
+                err = m.name + ": " + toString(std::move(e));
+                return false;
+            }
+        }
+
+        // Backends call this from their own threads, each with its own task.
+        std::vector<std::string> paths(lto.getMaxTasks());
+        auto add_stream = [&](unsigned task, const Twine &) -> Expected<std::unique_ptr<CachedFileStream>>
+        {
+            std::string path = (std::filesystem::path(output_dir) / ("thinlto." + std::to_string(task) + ".o")).string();
+            std::error_code ec;
+            auto os = std::make_unique<raw_fd_ostream>(path, ec, sys::fs::OF_None);
+            if (ec)
+                return errorCodeToError(ec);
+            paths[task] = path;
+            return std::make_unique<CachedFileStream>(std::move(os), path);
+        };
+
+        if (Error e = lto.run(add_stream))
+        {
+            err = toString(std::move(e));
+            return false;
+        }
+
+        for (auto &p : paths)
+        {
+            if (!p.empty())
+                objects.push_back(std::move(p));
+        }
+        return true;
+    }
+}
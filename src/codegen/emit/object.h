@@ -0,0 +1,172 @@
+#pragma once
+#include "../codegen.h"
+#include <llvm/ADT/StringMap.h>
+#include <llvm/CodeGen/ParallelCG.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+#include <llvm/TargetParser/Host.h>
+#include <llvm/TargetParser/SubtargetFeature.h>
+#include <llvm/TargetParser/Triple.h>
+#include <mutex>
+
+using namespace llvm;
+using namespace codegen;
+
+// "native" expands to the host CPU and everything it supports; explicit
+// features are applied on top.
+static void resolve_cpu_features(const TargetConfig &cfg, std::string &cpu, SubtargetFeatures &features)
+{
+    cpu = cfg.cpu.empty() ? "generic" : cfg.cpu;
+    if (cfg.cpu == "native")
+    {
+        cpu = sys::getHostCPUName().str();
+        StringMap<bool> host;
+        if (sys::getHostCPUFeatures(host))
+        {
+            for (const auto &f : host)
+                features.AddFeature(f.first(), f.second);
+        }
+    }
+    if (!cfg.features.empty())
+    {
+        SubtargetFeatures extra(cfg.features);
+        for (const auto &f : extra.getFeatures())
+            features.AddFeature(f);
+    }
+}
+
+bool CodeGen::set_target(const TargetConfig &cfg)
+{
+    std::string triple = cfg.triple.empty() ? sys::getDefaultTargetTriple() : Triple::normalize(cfg.triple);
+
+    // Only the host backend is registered up front; cross targets pull in
+    // the rest on first use.
+    if (Triple(triple).getArch() != Triple(sys::getDefaultTargetTriple()).getArch())
+    {
+        static std::once_flag all_init;
+        std::call_once(all_init, []
+                       {
+            InitializeAllTargetInfos();
+            InitializeAllTargets();
+            InitializeAllTargetMCs();
+            InitializeAllAsmPrinters(); });
+    }
+
+    std::string err;
+    const Target *target = TargetRegistry::lookupTarget(triple, err);
+    if (!target)
+    {
+        error("no target for " + triple + ": " + err);
+        return false;
+    }
+
+    std::string cpu;
+    SubtargetFeatures features;
+    resolve_cpu_features(cfg, cpu, features);
+
+    // PIC so the object links into the position-independent executables
+    // that system toolchains produce by default.
+    TargetOptions opts;
+    target_machine.reset(target->createTargetMachine(triple, cpu, features.getString(), opts, Reloc::PIC_));
+    if (!target_machine)
+    {
+        error("could not create target machine for " + triple);
+        return false;
+    }
+
+    module->setTargetTriple(target_machine->getTargetTriple().str());
+    module->setDataLayout(target_machine->createDataLayout());
+    return true;
+}
+
+bool CodeGen::write_native_file(const std::string &path, bool assembly)
+{
+    if (!target_machine)
+    {
+        error("no target machine configured");
+        return false;
+    }
+
+    std::error_code EC;
+    raw_fd_ostream dest(path, EC, assembly ? sys::fs::OF_Text : sys::fs::OF_None);
+    if (EC)
+    {
+        error("could not open " + path + ": " + EC.message());
+        return false;
+    }
+
+    if (!emit_native(dest, assembly))
+        return false;
+    dest.flush();
+    return true;
+}
+
+bool CodeGen::write_native_object(SmallVectorImpl<char> &out)
+{
+    if (!target_machine)
+    {
+        error("no target machine configured");
+        return false;
+    }
+
+    raw_svector_ostream dest(out);
+    return emit_native(dest, false);
+}
+
+bool CodeGen::emit_native(raw_pwrite_stream &dest, bool assembly)
+{
+    legacy::PassManager pm;
+    auto kind = assembly ? CodeGenFileType::AssemblyFile : CodeGenFileType::ObjectFile;
+    if (target_machine->addPassesToEmitFile(pm, dest, nullptr, kind))
+    {
+        error("target cannot emit this file type");
+        return false;
+    }
+    pm.run(*module);
+    return true;
+}
+
+bool CodeGen::write_native_files(const std::vector<std::string> &paths, bool assembly)
+{
+    if (paths.size() == 1)
+        return write_native_file(paths.front(), assembly);
+    if (!target_machine)
+    {
+        error("no target machine configured");
+        return false;
+    }
+
+    std::vector<std::unique_ptr<raw_fd_ostream>> files;
+    std::vector<raw_pwrite_stream *> streams;
+    for (const auto &path : paths)
+    {
+        std::error_code EC;
+        files.push_back(std::make_unique<raw_fd_ostream>(path, EC, assembly ? sys::fs::OF_Text : sys::fs::OF_None));
+        if (EC)
+        {
+            error("could not open " + path + ": " + EC.message());
+            return false;
+        }
+        streams.push_back(files.back().get());
+    }
+
+    // Each partition is lowered in its own context on its own thread, so
+    // every thread needs a target machine of its own.
+    const TargetMachine &tm = *target_machine;
+    auto make_tm = [&tm]()
+    {
+        return std::unique_ptr<TargetMachine>(tm.getTarget().createTargetMachine(
+            tm.getTargetTriple().str(), tm.getTargetCPU(), tm.getTargetFeatureString(), tm.Options,
+            tm.getRelocationModel(), tm.getCodeModel(), tm.getOptLevel()));
+    };
+
+    splitCodeGen(*module, streams, {}, make_tm,
+                 assembly ? CodeGenFileType::AssemblyFile : CodeGenFileType::ObjectFile);
+    for (auto &f : files)
+        f->flush();
+    return true;
+}
@@ -0,0 +1,305 @@
+#pragma once
+#include "../codegen.h"
+#include <llvm/ADT/SetVector.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/IndirectionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace llvm;
+using namespace codegen;
+
+// Calls plus loop back-edges a function runs before it is recompiled.
+static constexpr uint64_t tier_up_threshold = 10000;
+
+// Recompiled modules carry this suffix on their identifier.
+static const char tier2_suffix[] = ".tier2";
+
+// Picks the backend per module: FastISel for the baseline, everything for
+// the modules the tier-up thread produces.
+class TieredCompiler : public orc::IRCompileLayer::IRCompiler
+{
+public:
+    explicit TieredCompiler(orc::JITTargetMachineBuilder jtmb)
+        : IRCompiler(orc::irManglingOptionsFromTargetOptions(jtmb.getOptions())), jtmb(std::move(jtmb)) {}
+
+    Expected<std::unique_ptr<MemoryBuffer>> operator()(Module &m) override
+    {
+        orc::JITTargetMachineBuilder b = jtmb;
+        b.setCodeGenOptLevel(StringRef(m.getModuleIdentifier()).ends_with(tier2_suffix)
+                                 ? CodeGenOptLevel::Aggressive
+                                 : CodeGenOptLevel::None);
+        auto tm = b.createTargetMachine();
+        if (!tm)
+            return tm.takeError();
+        return orc::SimpleCompiler(**tm)(m);
+    }
+
+private:
+    orc::JITTargetMachineBuilder jtmb;
+};
+
+// Every function is called through an ORC stub under its own name. The
+// baseline body is F$tier0 and counts its calls and back-edges; at the
+// threshold it queues its id, and the compile thread builds F$tier2 at O3
+// from an uninstrumented copy and repoints the stub.
+struct CodeGen::Tiering
+{
+    orc::LLJIT &jit;
+    std::unique_ptr<orc::IndirectStubsManager> stubs;
+    SmallVector<char, 0> pristine;
+    std::vector<std::string> names;
+    std::atomic<size_t> promoted{0};
+
+    std::mutex mu;
+    std::condition_variable cv;
+    std::deque<uint32_t> queue;
+    bool stop = false;
+    std::thread worker;
+
+    explicit Tiering(orc::LLJIT &jit) : jit(jit) {}
+
+    ~Tiering()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            stop = true;
+        }
+        cv.notify_all();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    // Called from JIT-compiled code.
+    static void hot(Tiering *t, uint32_t id)
+    {
+        {
+            std::lock_guard<std::mutex> lock(t->mu);
+            t->queue.push_back(id);
+        }
+        t->cv.notify_one();
+    }
+
+    void run()
+    {
+        for (;;)
+        {
+            uint32_t id;
+            {
+                std::unique_lock<std::mutex> lock(mu);
+                cv.wait(lock, [this]
+                        { return stop || !queue.empty(); });
+                if (stop)
+                    return;
+                id = queue.front();
+                queue.pop_front();
+            }
+            // A failed recompile leaves the baseline in place.
+            if (Error e = promote(names[id]))
+                consumeError(std::move(e));
+        }
+    }
+
+    Error promote(const std::string &name)
+    {
+        auto ctx = std::make_unique<LLVMContext>();
+        auto m = parseBitcodeFile(MemoryBufferRef(StringRef(pristine.data(), pristine.size()), name + tier2_suffix), *ctx);
+        if (!m)
+            return m.takeError();
+
+        // Only the hot function is emitted. The other bodies stay visible
+        // to the inliner, and globals resolve to the baseline's copies.
+        for (Function &f : **m)
+        {
+            if (f.isDeclaration())
+                continue;
+            if (f.getName() == name)
+                f.setName(name + "$tier2");
+            else
+                f.setLinkage(GlobalValue::AvailableExternallyLinkage);
+        }
+        for (GlobalVariable &gv : (*m)->globals())
+        {
+            if (!gv.isDeclaration())
+                gv.setLinkage(GlobalValue::AvailableExternallyLinkage);
+        }
+
+        LoopAnalysisManager LAM;
+        FunctionAnalysisManager FAM;
+        CGSCCAnalysisManager CGAM;
+        ModuleAnalysisManager MAM;
+        PassBuilder PB;
+        PB.registerModuleAnalyses(MAM);
+        PB.registerCGSCCAnalyses(CGAM);
+        PB.registerFunctionAnalyses(FAM);
+        PB.registerLoopAnalyses(LAM);
+        PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+        PB.buildPerModuleDefaultPipeline(OptimizationLevel::O3).run(**m, MAM);
+
+        if (Error e = jit.addIRModule(orc::ThreadSafeModule(std::move(*m), std::move(ctx))))
+            return e;
+        auto addr = jit.lookup(name + "$tier2");
+        if (!addr)
+            return addr.takeError();
+        if (Error e = stubs->updatePointer(name, *addr))
+            return e;
+        ++promoted;
+        return Error::success();
+    }
+};
+
+// Adds `counter += 1` before `at`, queueing the function once the count
+// reaches the threshold.
+static void add_tier_counter(GlobalVariable *counter, Instruction *at, FunctionCallee notify, Value *state, uint32_t id)
+{
+    IRBuilder<> b(at);
+    Type *i64 = b.getInt64Ty();
+    Value *n = b.CreateAdd(b.CreateLoad(i64, counter), ConstantInt::get(i64, 1));
+    b.CreateStore(n, counter);
+    Value *hot = b.CreateICmpEQ(n, ConstantInt::get(i64, tier_up_threshold));
+    IRBuilder<> then(SplitBlockAndInsertIfThen(hot, at, false));
+    then.CreateCall(notify, {state, then.getInt32(id)});
+}
+
+bool CodeGen::jit_add_tiered(std::unique_ptr<Module> m, std::unique_ptr<LLVMContext> ctx)
+{
+    tiering = std::make_unique<Tiering>(*jit);
+    Tiering &t = *tiering;
+
+    // Recompiled functions live in other modules, so everything they can
+    // reach by name has to be visible across modules.
+    unsigned anon = 0;
+    for (GlobalValue &gv : m->global_values())
+    {
+        if (gv.isDeclaration())
+            continue;
+        if (!gv.hasName())
+            gv.setName("__tier.anon." + std::to_string(anon++));
+        if (gv.hasLocalLinkage())
+        {
+            gv.setLinkage(GlobalValue::ExternalLinkage);
+            gv.setVisibility(GlobalValue::DefaultVisibility);
+        }
+    }
+
+    raw_svector_ostream os(t.pristine);
+    WriteBitcodeToFile(*m, os);
+
+    // Callers now reach each function through a declaration of its name,
+    // which resolves to the stub.
+    std::vector<Function *> bodies;
+    for (Function &f : *m)
+    {
+        if (!f.isDeclaration())
+            bodies.push_back(&f);
+    }
+    for (Function *f : bodies)
+    {
+        std::string name = f->getName().str();
+        f->setName(name + "$tier0");
+        Function *decl = Function::Create(f->getFunctionType(), GlobalValue::ExternalLinkage, name, m.get());
+        f->replaceAllUsesWith(decl);
+        t.names.push_back(name);
+    }
+
+    LLVMContext &c = m->getContext();
+    Type *i64 = Type::getInt64Ty(c);
+    PointerType *ptr = PointerType::getUnqual(c);
+    FunctionCallee notify = m->getOrInsertFunction("__ecc_tier_hot", Type::getVoidTy(c), ptr, Type::getInt32Ty(c));
+    Value *state = ConstantExpr::getIntToPtr(ConstantInt::get(i64, reinterpret_cast<uint64_t>(&t)), ptr);
+
+    for (uint32_t id = 0; id < bodies.size(); ++id)
+    {
+        Function *f = bodies[id];
+        auto *counter = new GlobalVariable(*m, i64, false, GlobalValue::InternalLinkage,
+                                           ConstantInt::get(i64, 0), "__tier.count." + t.names[id]);
+
+        DominatorTree dt(*f);
+        LoopInfo li(dt);
+        // A block can be the latch of several nested loops; it gets one
+        // counter, so each trip through it counts once.
+        SmallSetVector<BasicBlock *, 8> latches;
+        SmallVector<BasicBlock *, 4> loop_latches;
+        for (Loop *l : li.getLoopsInPreorder())
+        {
+            loop_latches.clear();
+            l->getLoopLatches(loop_latches);
+            latches.insert(loop_latches.begin(), loop_latches.end());
+        }
+
+        // Allocas stay in the entry block, ahead of the split.
+        BasicBlock::iterator entry = f->getEntryBlock().getFirstInsertionPt();
+        while (isa<AllocaInst>(*entry))
+            ++entry;
+        add_tier_counter(counter, &*entry, notify, state, id);
+        for (BasicBlock *latch : latches)
+            add_tier_counter(counter, latch->getTerminator(), notify, state, id);
+    }
+
+    auto stubs_builder = orc::createLocalIndirectStubsManagerBuilder(jit->getTargetTriple());
+    if (!stubs_builder)
+    {
+        error("jit: no indirect stubs for " + jit->getTargetTriple().str());
+        return false;
+    }
+    t.stubs = stubs_builder();
+
+    orc::IndirectStubsManager::StubInitsMap inits;
+    for (const auto &name : t.names)
+        inits[name] = {orc::ExecutorAddr(), JITSymbolFlags::Exported | JITSymbolFlags::Callable};
+    if (Error e = t.stubs->createStubs(inits))
+    {
+        error("jit: " + toString(std::move(e)));
+        return false;
+    }
+
+    orc::SymbolMap symbols;
+    for (const auto &name : t.names)
+        symbols[jit->mangleAndIntern(name)] = t.stubs->findStub(name, false);
+    symbols[jit->mangleAndIntern("__ecc_tier_hot")] = {orc::ExecutorAddr::fromPtr(&Tiering::hot),
+                                                        JITSymbolFlags::Exported | JITSymbolFlags::Callable};
+    if (Error e = jit->getMainJITDylib().define(orc::absoluteSymbols(std::move(symbols))))
+    {
+        error("jit: " + toString(std::move(e)));
+        return false;
+    }
+
+    if (Error e = jit->addIRModule(orc::ThreadSafeModule(std::move(m), std::move(ctx))))
+    {
+        error("jit: " + toString(std::move(e)));
+        return false;
+    }
+    for (const auto &name : t.names)
+    {
+        auto addr = jit->lookup(name + "$tier0");
+        if (!addr)
+        {
+            error("jit: " + toString(addr.takeError()));
+            return false;
+        }
+        if (Error e = t.stubs->updatePointer(name, *addr))
+        {
+            error("jit: " + toString(std::move(e)));
+            return false;
+        }
+    }
+
+    t.worker = std::thread([&t]
+                           { t.run(); });
+    return true;
+}
+
+size_t CodeGen::jit_promoted() const
+{
+    return tiering ? tiering->promoted.load() : 0;
+}
@@ -221,7 +221,7 @@ Value *CodeGen::codegen_binary(const ast::BinaryExpr *be)
                 return builder.CreateZExt(builder.CreateICmpEQ(L, nullPtr, "cmptmp"), get_int_type());
             if (be->op == "!=")
                 return builder.CreateZExt(builder.CreateICmpNE(L, nullPtr, "cmptmp"), get_int_type());
-            error("unsupported pointer comparison for " + be->op);
+            error("unsupported pointer comparison for " + std::string(be->op));
         }
         else
         {
@@ -270,6 +270,6 @@ Value *CodeGen::codegen_binary(const ast::BinaryExpr *be)
         }
     }
 
-    error("unsupported binary op: " + be->op);
+    error("unsupported binary op: " + std::string(be->op));
     return nullptr;
 }
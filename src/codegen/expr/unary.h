@@ -26,7 +26,7 @@ Value *CodeGen::codegen_unary(const ast::UnaryExpr *ue)
         Value *ptr = nullptr;
         Type *destElemTy = nullptr;
 
-        if (auto id = dynamic_cast<const ast::Ident *>(target))
+        if (auto id = ast::as<ast::Ident>(target))
         {
             ptr = lookup_local(id->name);
             if (!ptr)
@@ -35,7 +35,7 @@ Value *CodeGen::codegen_unary(const ast::UnaryExpr *ue)
                 return nullptr;
             }
         }
-        else if (auto ie = dynamic_cast<const ast::IndexExpr *>(target))
+        else if (auto ie = ast::as<ast::IndexExpr>(target))
         {
             ptr = codegen_index_addr(ie);
             if (!ptr)
@@ -129,7 +129,7 @@ Value *CodeGen::codegen_unary(const ast::UnaryExpr *ue)
             return nullptr;
         }
 
-        if (auto id = dynamic_cast<const ast::Ident *>(target))
+        if (auto id = ast::as<ast::Ident>(target))
         {
             Value *loc = lookup_local(id->name);
             if (!loc)
@@ -140,14 +140,14 @@ Value *CodeGen::codegen_unary(const ast::UnaryExpr *ue)
 
             return loc;
         }
-        else if (auto ie = dynamic_cast<const ast::IndexExpr *>(target))
+        else if (auto ie = ast::as<ast::IndexExpr>(target))
         {
             Value *addr = codegen_index_addr(ie);
             if (!addr)
                 return nullptr;
             return addr;
         }
-        else if (auto me = dynamic_cast<const ast::MemberExpr *>(target))
+        else if (auto me = ast::as<ast::MemberExpr>(target))
         {
             Value *addr = codegen_member_addr(me);
             if (!addr)
@@ -172,7 +172,7 @@ Value *CodeGen::codegen_unary(const ast::UnaryExpr *ue)
 
         Value *ptrVal = nullptr;
 
-        if (auto id = dynamic_cast<const ast::Ident *>(target))
+        if (auto id = ast::as<ast::Ident>(target))
         {
             Value *loc = lookup_local(id->name);
             if (!loc)
@@ -203,14 +203,14 @@ Value *CodeGen::codegen_unary(const ast::UnaryExpr *ue)
             }
         }
 
-        else if (auto me = dynamic_cast<const ast::MemberExpr *>(target))
+        else if (auto me = ast::as<ast::MemberExpr>(target))
         {
             Value *fieldAddr = codegen_member_addr(me);
             if (!fieldAddr)
                 return nullptr;
 
-            std::string varname;
-            if (auto id = dynamic_cast<const ast::Ident *>(me->object.get()))
+            ast::Symbol varname;
+            if (auto id = ast::as<ast::Ident>(me->object.get()))
                 varname = id->name;
 
             llvm::StructType *st = get_struct_type_from_value(lookup_local(varname), varname);
@@ -220,7 +220,7 @@ Value *CodeGen::codegen_unary(const ast::UnaryExpr *ue)
                 return nullptr;
             }
 
-            const ast::StructDecl *sd = struct_decls[st->getName().str()];
+            const ast::StructDecl *sd = struct_decls[ast::intern(st->getName())];
             int idx = get_field_index(sd, me->member);
             llvm::Type *fieldTy = st->getElementType(idx);
 
@@ -290,6 +290,6 @@ Value *CodeGen::codegen_unary(const ast::UnaryExpr *ue)
         }
     }
 
-    error("unsupported unary op: " + ue->op);
+    error("unsupported unary op: " + std::string(ue->op));
     return nullptr;
 }
@@ -12,7 +12,7 @@ using namespace codegen;
 
 Value *CodeGen::codegen_call(const ast::CallExpr *ce)
 {
-    if (auto ident = dynamic_cast<const ast::Ident *>(ce->callee.get()))
+    if (auto ident = ast::as<ast::Ident>(ce->callee.get()))
     {
         if (ident->name == "println")
         {
@@ -56,7 +56,7 @@ Value *CodeGen::codegen_call(const ast::CallExpr *ce)
 
     if (!F)
     {
-        if (auto id = dynamic_cast<const ast::Ident *>(ce->callee.get()))
+        if (auto id = ast::as<ast::Ident>(ce->callee.get()))
         {
             auto it = function_protos.find(id->name);
             if (it != function_protos.end())
@@ -28,10 +28,8 @@ Value *CodeGen::codegen_cast_call(const ast::CallExpr *ce)
     }
 
     llvm::Type *dstType = nullptr;
-    if (auto astType = dynamic_cast<const ast::Type *>(ce->args[0].get()))
-        dstType = resolve_type_from_ast_local(astType);
-    else if (auto typeIdent = dynamic_cast<const ast::Ident *>(ce->args[0].get()))
-        dstType = resolve_type_by_name(typeIdent->name);
+    if (auto typeIdent = ast::as<ast::Ident>(ce->args[0].get()))
+        dstType = resolve_type_by_name(typeIdent->name.str());
     else
     {
         error("cast: first argument must be a type (type literal or type name)");
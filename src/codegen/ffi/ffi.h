@@ -25,7 +25,7 @@ void CodeGen::register_builtin_ffi()
     {
         llvm::FunctionType *ft = llvm::FunctionType::get(ret, args, vararg);
         llvm::Function *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, module.get());
-        function_protos[name] = f;
+        function_protos[ast::intern(name)] = f;
         return f;
     };
 
@@ -109,7 +109,7 @@ void CodeGen::register_builtin_ffi()
 
         llvm::FunctionType *ft = llvm::FunctionType::get(iTy, {iTy}, true);
         llvm::Function *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, "syscall", module.get());
-        function_protos["syscall"] = f;
+        function_protos[ast::intern("syscall")] = f;
     }
 
     addFunc("strlen", iTy, {i8ptr});
@@ -25,16 +25,16 @@ Value *CodeGen::codegen_len_call(const ast::CallExpr *ce)
 
     bool isStr = false;
 
-    if (const auto id = dynamic_cast<const ast::Ident *>(ce->args[0].get()))
+    if (const auto id = ast::as<ast::Ident>(ce->args[0].get()))
     {
         if (*lookup_local_type(id->name) == std::string("string"))
         {
             isStr = true;
         }
     }
-    else if (const auto as = dynamic_cast<const ast::IndexExpr *>(ce->args[0].get()))
+    else if (const auto as = ast::as<ast::IndexExpr>(ce->args[0].get()))
     {
-        if (const auto id = dynamic_cast<const ast::Ident *>(as->collection.get()))
+        if (const auto id = ast::as<ast::Ident>(as->collection.get()))
         {
             ParsedType pt = parse_type_chain(*lookup_local_type(id->name));
             if (pt.base == std::string("string"))
@@ -45,7 +45,7 @@ Value *CodeGen::codegen_len_call(const ast::CallExpr *ce)
     }
 
     Module *M = module.get();
-    DataLayout dl(M);
+    const DataLayout &dl = M->getDataLayout();
 
     StructType *arrayStruct = detail::getOrCreateArrayStruct(context);
     Type *arrayPtrTy = arrayStruct->getPointerTo();
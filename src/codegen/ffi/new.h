@@ -20,18 +20,13 @@ Value *CodeGen::codegen_new_call(const ast::CallExpr *ce)
 
     const ast::Expr *typeArg = ce->args[0].get();
 
-    const ast::ArrayLiteral *arrLit = dynamic_cast<const ast::ArrayLiteral *>(typeArg);
-    const ast::ArrayType *arrType = dynamic_cast<const ast::ArrayType *>(typeArg);
+    const ast::ArrayLiteral *arrLit = ast::as<ast::ArrayLiteral>(typeArg);
 
     const ast::Type *elemAstType = nullptr;
     if (arrLit)
     {
         elemAstType = arrLit->array_type.get();
     }
-    else if (arrType)
-    {
-        elemAstType = arrType->elem.get();
-    }
     else
     {
         error("new currently supports array type like new([]T)");
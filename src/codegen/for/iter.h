@@ -43,7 +43,7 @@ Value *CodeGen::codegen_forinstmt(const ast::ForInStmt *fs)
         Value *cond = builder.CreateICmpNE(ch, zero8, "forin.cond");
         builder.CreateCondBr(cond, bodyBB, afterBB);
 
-        Value *varAlloca = create_entry_alloca(F, get_int_type(), fs->var);
+        Value *varAlloca = create_entry_alloca(F, get_int_type(), fs->var.str());
 
         break_targets.push_back(afterBB);
         continue_targets.push_back(incrBB);
@@ -113,7 +113,7 @@ Value *CodeGen::codegen_forinstmt(const ast::ForInStmt *fs)
         Value *cmp = builder.CreateICmpSLT(idxLoad, endVal, "forin.cmp");
         builder.CreateCondBr(cmp, bodyBB, afterBB);
 
-        Value *varAlloca = create_entry_alloca(F, get_int_type(), fs->var);
+        Value *varAlloca = create_entry_alloca(F, get_int_type(), fs->var.str());
 
         break_targets.push_back(afterBB);
         continue_targets.push_back(incrBB);
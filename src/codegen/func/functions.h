@@ -17,12 +17,12 @@ llvm::Type *CodeGen::resolve_type_from_ast_local(const ast::Type *astType)
     if (!astType)
         return nullptr;
 
-    if (auto namedType = dynamic_cast<const ast::NamedType *>(astType))
+    if (auto namedType = ast::as<ast::NamedType>(astType))
     {
-        return resolve_type_by_name(namedType->name);
+        return resolve_type_by_name(namedType->name.str());
     }
 
-    if (auto pointerType = dynamic_cast<const ast::PointerType *>(astType))
+    if (auto pointerType = ast::as<ast::PointerType>(astType))
     {
         llvm::Type *innerType = resolve_type_from_ast_local(pointerType->base.get());
         if (!innerType)
@@ -30,7 +30,7 @@ llvm::Type *CodeGen::resolve_type_from_ast_local(const ast::Type *astType)
         return llvm::PointerType::getUnqual(innerType);
     }
 
-    if (auto arrayType = dynamic_cast<const ast::ArrayType *>(astType))
+    if (auto arrayType = ast::as<ast::ArrayType>(astType))
     {
         llvm::Type *elementType = resolve_type_from_ast_local(arrayType->elem.get());
         if (!elementType)
@@ -39,7 +39,7 @@ llvm::Type *CodeGen::resolve_type_from_ast_local(const ast::Type *astType)
         return llvm::PointerType::getUnqual(elementType);
     }
 
-    if (auto funcTypeAst = dynamic_cast<const ast::FuncType *>(astType))
+    if (auto funcTypeAst = ast::as<ast::FuncType>(astType))
     {
         std::vector<llvm::Type *> paramTypes;
         for (const auto &param : funcTypeAst->params)
@@ -119,7 +119,7 @@ void CodeGen::predeclare_functions(const std::vector<const ast::FuncDecl *> &fun
 
         FunctionType *functionType = FunctionType::get(returnType, argTypes, isVarArg);
 
-        Function *existing = module->getFunction(funcDecl->name);
+        Function *existing = module->getFunction(symbol_name(funcDecl));
         if (existing)
         {
             function_protos[funcDecl->name] = existing;
@@ -128,7 +128,7 @@ void CodeGen::predeclare_functions(const std::vector<const ast::FuncDecl *> &fun
 
         bool is_main = (funcDecl->name == "main");
         auto linkage = (funcDecl->is_pub || is_main) ? Function::ExternalLinkage : Function::InternalLinkage;
-        Function *fn = Function::Create(functionType, linkage, funcDecl->name, module.get());
+        Function *fn = Function::Create(functionType, linkage, symbol_name(funcDecl), module.get());
 
         unsigned argIndex = 0;
         for (auto &arg : fn->args())
@@ -148,7 +148,7 @@ void CodeGen::predeclare_functions(const std::vector<const ast::FuncDecl *> &fun
                 }
                 if (p < funcDecl->params.size())
                 {
-                    arg.setName(funcDecl->params[p].name);
+                    arg.setName(funcDecl->params[p].name.str());
                 }
             }
             ++argIndex;
@@ -166,7 +166,8 @@ Function *CodeGen::codegen_function_decl(const ast::FuncDecl *funcDecl)
     LLVMContext &context = builder.getContext();
     Module *M = module.get();
 
-    std::cout << "code generating..." << std::endl;
+    if (irdebug)
+        std::cout << "code generating..." << std::endl;
 
     bool isVarArg = false;
     if (!funcDecl->params.empty() && funcDecl->params.back().variadic)
@@ -208,12 +209,12 @@ Function *CodeGen::codegen_function_decl(const ast::FuncDecl *funcDecl)
 
     FunctionType *functionType = FunctionType::get(returnType, argTypes, isVarArg);
 
-    Function *functionValue = module->getFunction(funcDecl->name);
+    Function *functionValue = module->getFunction(symbol_name(funcDecl));
     if (!functionValue)
     {
         bool is_main = (funcDecl->name == "main");
         auto linkage = (funcDecl->is_pub || is_main) ? Function::ExternalLinkage : Function::InternalLinkage;
-        functionValue = Function::Create(functionType, linkage, funcDecl->name, module.get());
+        functionValue = Function::Create(functionType, linkage, symbol_name(funcDecl), module.get());
         function_protos[funcDecl->name] = functionValue;
     }
     else
@@ -261,8 +262,8 @@ Function *CodeGen::codegen_function_decl(const ast::FuncDecl *funcDecl)
             }
         }
 
-        std::string argName = (p < funcDecl->params.size() ? funcDecl->params[p].name : std::string(arg.getName()));
-        arg.setName(argName);
+        ast::Symbol argName = (p < funcDecl->params.size() ? funcDecl->params[p].name : ast::intern(arg.getName()));
+        arg.setName(argName.str());
 
         ast::Type *paramAstType = (p < funcDecl->params.size()) ? funcDecl->params[p].type.get() : nullptr;
 
@@ -274,7 +275,7 @@ Function *CodeGen::codegen_function_decl(const ast::FuncDecl *funcDecl)
         }
         else
         {
-            Value *localAlloca = entryBuilder.CreateAlloca(arg.getType(), nullptr, argName);
+            Value *localAlloca = entryBuilder.CreateAlloca(arg.getType(), nullptr, argName.str());
             entryBuilder.CreateStore(&arg, localAlloca);
             bind_local(argName, pt.base + "_params", localAlloca);
         }
@@ -291,7 +292,7 @@ Function *CodeGen::codegen_function_decl(const ast::FuncDecl *funcDecl)
             elemType = get_int_type();
 
         llvm::Type *holderType = llvm::PointerType::getUnqual(elemType);
-        Value *varAlloca = entryBuilder.CreateAlloca(holderType, nullptr, vparam.name);
+        Value *varAlloca = entryBuilder.CreateAlloca(holderType, nullptr, vparam.name.str());
 
         entryBuilder.CreateStore(Constant::getNullValue(holderType), varAlloca);
         bind_local(vparam.name, "ptr", varAlloca);
@@ -299,8 +300,8 @@ Function *CodeGen::codegen_function_decl(const ast::FuncDecl *funcDecl)
 
     push_scope();
 
-    if (funcDecl->body)
-        codegen_block(funcDecl->body.get());
+    if (auto body = funcDecl->get_body())
+        codegen_block(body);
 
     if (auto currentBB = builder.GetInsertBlock())
     {
@@ -313,9 +314,11 @@ Function *CodeGen::codegen_function_decl(const ast::FuncDecl *funcDecl)
         }
     }
 
-    if (verifyFunction(*functionValue, &errs()))
+    std::string problems;
+    raw_string_ostream problems_os(problems);
+    if (verifyFunction(*functionValue, &problems_os))
     {
-        error("function verification failed: " + funcDecl->name);
+        error("function verification failed: " + funcDecl->name + ": " + StringRef(problems_os.str()).trim().str());
         functionValue->eraseFromParent();
         pop_scope();
         return nullptr;
@@ -0,0 +1,177 @@
+#pragma once
+#include "../codegen.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace codegen;
+
+// Every name a node refers to that could be a function. Methods are called
+// through a member, so member names count as well.
+static void collect_callee_names(const ast::Node *n, std::vector<ast::Symbol> &out)
+{
+    if (!n)
+        return;
+
+    auto all = [&out](const auto &list)
+    {
+        for (const auto &c : list)
+            collect_callee_names(c.get(), out);
+    };
+
+    switch (n->kind)
+    {
+    case ast::NodeKind::Ident:
+        out.push_back(static_cast<const ast::Ident *>(n)->name);
+        return;
+    case ast::NodeKind::UnaryExpr:
+        collect_callee_names(static_cast<const ast::UnaryExpr *>(n)->rhs.get(), out);
+        return;
+    case ast::NodeKind::BinaryExpr:
+    {
+        auto e = static_cast<const ast::BinaryExpr *>(n);
+        collect_callee_names(e->left.get(), out);
+        collect_callee_names(e->right.get(), out);
+        return;
+    }
+    case ast::NodeKind::CallExpr:
+    {
+        auto e = static_cast<const ast::CallExpr *>(n);
+        collect_callee_names(e->callee.get(), out);
+        all(e->args);
+        return;
+    }
+    case ast::NodeKind::ArrayLiteral:
+        all(static_cast<const ast::ArrayLiteral *>(n)->elements);
+        return;
+    case ast::NodeKind::ByteArrayLiteral:
+        all(static_cast<const ast::ByteArrayLiteral *>(n)->elems);
+        return;
+    case ast::NodeKind::MemberExpr:
+    {
+        auto e = static_cast<const ast::MemberExpr *>(n);
+        collect_callee_names(e->object.get(), out);
+        out.push_back(e->member);
+        return;
+    }
+    case ast::NodeKind::IndexExpr:
+    {
+        auto e = static_cast<const ast::IndexExpr *>(n);
+        collect_callee_names(e->collection.get(), out);
+        collect_callee_names(e->index.get(), out);
+        return;
+    }
+    case ast::NodeKind::PostfixExpr:
+        collect_callee_names(static_cast<const ast::PostfixExpr *>(n)->lhs.get(), out);
+        return;
+    case ast::NodeKind::StructLiteral:
+        for (const auto &init : static_cast<const ast::StructLiteral *>(n)->inits)
+            collect_callee_names(init.value.get(), out);
+        return;
+
+    case ast::NodeKind::ExprStmt:
+        collect_callee_names(static_cast<const ast::ExprStmt *>(n)->expr.get(), out);
+        return;
+    case ast::NodeKind::ReturnStmt:
+        collect_callee_names(static_cast<const ast::ReturnStmt *>(n)->expr.get(), out);
+        return;
+    case ast::NodeKind::VarDecl:
+        collect_callee_names(static_cast<const ast::VarDecl *>(n)->init.get(), out);
+        return;
+    case ast::NodeKind::AssignStmt:
+    {
+        auto s = static_cast<const ast::AssignStmt *>(n);
+        collect_callee_names(s->target.get(), out);
+        collect_callee_names(s->value.get(), out);
+        return;
+    }
+    case ast::NodeKind::BlockStmt:
+        all(static_cast<const ast::BlockStmt *>(n)->stmts);
+        return;
+    case ast::NodeKind::IfStmt:
+    {
+        auto s = static_cast<const ast::IfStmt *>(n);
+        collect_callee_names(s->cond.get(), out);
+        collect_callee_names(s->then_blk.get(), out);
+        collect_callee_names(s->else_blk.get(), out);
+        return;
+    }
+    case ast::NodeKind::ForInStmt:
+    {
+        auto s = static_cast<const ast::ForInStmt *>(n);
+        collect_callee_names(s->iterable.get(), out);
+        collect_callee_names(s->body.get(), out);
+        return;
+    }
+    case ast::NodeKind::ForStmt:
+        collect_callee_names(static_cast<const ast::ForStmt *>(n)->body.get(), out);
+        return;
+    case ast::NodeKind::ForCStyleStmt:
+    {
+        auto s = static_cast<const ast::ForCStyleStmt *>(n);
+        collect_callee_names(s->init.get(), out);
+        collect_callee_names(s->cond.get(), out);
+        collect_callee_names(s->post.get(), out);
+        collect_callee_names(s->body.get(), out);
+        return;
+    }
+    default:
+        return;
+    }
+}
+
+// Only used when some body was skipped by the parser: walks the call graph
+// from the roots, parsing bodies as it reaches them, and drops the rest.
+// The roots are main and every pub function: other units, and C code
+// passed with --link-arg, may call a pub function, so it is emitted just as
+// without lazy bodies. A program with neither keeps everything.
+std::vector<const ast::FuncDecl *> CodeGen::reachable_functions(const std::vector<const ast::FuncDecl *> &funcs)
+{
+    std::unordered_map<ast::Symbol, std::vector<const ast::FuncDecl *>> by_name;
+    for (const ast::FuncDecl *fd : funcs)
+        by_name[fd->name].push_back(fd);
+
+    std::vector<const ast::FuncDecl *> work;
+    for (const ast::FuncDecl *fd : funcs)
+    {
+        if (fd->name == "main" || fd->is_pub)
+            work.push_back(fd);
+    }
+    if (work.empty())
+        work = funcs;
+
+    std::unordered_set<const ast::FuncDecl *> seen(work.begin(), work.end());
+    std::vector<ast::Symbol> names;
+    while (!work.empty())
+    {
+        const ast::FuncDecl *fd = work.back();
+        work.pop_back();
+
+        bool pending = fd->body_pending();
+        const ast::BlockStmt *body = fd->get_body();
+        if (pending && !body)
+        {
+            error("could not parse the body of function: " + fd->name);
+            continue;
+        }
+
+        names.clear();
+        collect_callee_names(body, names);
+        for (ast::Symbol name : names)
+        {
+            auto it = by_name.find(name);
+            if (it == by_name.end())
+                continue;
+            for (const ast::FuncDecl *callee : it->second)
+                if (seen.insert(callee).second)
+                    work.push_back(callee);
+        }
+    }
+
+    // Declaration order is kept, so the output does not depend on the walk.
+    std::vector<const ast::FuncDecl *> out;
+    for (const ast::FuncDecl *fd : funcs)
+        if (seen.count(fd))
+            out.push_back(fd);
+    return out;
+}
@@ -17,7 +17,7 @@ Value *CodeGen::codegen_literal(const ast::Literal *lit)
     case lex::TokenType::INT:
     {
         long long v = 0;
-        const auto &s = lit->raw;
+        const std::string s(lit->raw);
 
         if (s.size() > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
         {
@@ -44,12 +44,12 @@ Value *CodeGen::codegen_literal(const ast::Literal *lit)
 
     case lex::TokenType::FLOAT:
     {
-        double d = std::stod(lit->raw);
+        double d = std::stod(std::string(lit->raw));
         return ConstantFP::get(get_double_type(), d);
     }
     case lex::TokenType::STRING:
     {
-        std::string raw = lit->raw;
+        std::string raw(lit->raw);
         if (!raw.empty() && (raw.front() == '"' || raw.front() == '`'))
         {
             raw = raw.substr(1, raw.size() - 2);
@@ -80,7 +80,7 @@ Value *CodeGen::codegen_literal(const ast::Literal *lit)
     }
     case lex::TokenType::CHAR:
     {
-        std::string raw = lit->raw;
+        std::string raw(lit->raw);
         char ch = '?';
         if (raw.size() >= 3 && raw.front() == '\'' && raw.back() == '\'')
         {
@@ -154,14 +154,14 @@ Value *CodeGen::codegen_byte_array(const ast::ByteArrayLiteral *bal)
             return nullptr;
         }
 
-        const ast::Literal *lit = dynamic_cast<const ast::Literal *>(elemPtr.get());
+        const ast::Literal *lit = ast::as<ast::Literal>(elemPtr.get());
         if (!lit)
         {
             error("byte array elements must be integer literals");
             return nullptr;
         }
 
-        const std::string &s = lit->raw;
+        const std::string s(lit->raw);
         long long v = 0;
 
         if (s.size() > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
@@ -24,7 +24,7 @@ Value *CodeGen::codegen_postfix(const ast::PostfixExpr *pe)
     Value *ptr = nullptr;
     Type *destElemTy = nullptr;
 
-    if (auto id = dynamic_cast<const ast::Ident *>(target))
+    if (auto id = ast::as<ast::Ident>(target))
     {
         ptr = lookup_local(id->name);
         if (!ptr)
@@ -33,7 +33,7 @@ Value *CodeGen::codegen_postfix(const ast::PostfixExpr *pe)
             return nullptr;
         }
     }
-    else if (auto ie = dynamic_cast<const ast::IndexExpr *>(target))
+    else if (auto ie = ast::as<ast::IndexExpr>(target))
     {
         ptr = codegen_index_addr(ie);
         if (!ptr)
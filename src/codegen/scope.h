@@ -0,0 +1,129 @@
+#pragma once
+#include "../ast/intern.h"
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace llvm
+{
+    class Value;
+}
+
+namespace codegen
+{
+    // Local variable bindings for every open scope in one structure.
+    //
+    // Bindings live on a single stack in the order they were made; each one
+    // links to the binding of the same name it shadows. An open-addressing
+    // table maps a symbol to its innermost binding, so a lookup is one probe
+    // no matter how deeply scopes nest. Opening a scope records the stack
+    // height and closing it pops back to that mark, restoring every name to
+    // the binding it shadowed. Nothing is allocated per scope.
+    class ScopeTable
+    {
+    public:
+        struct Binding
+        {
+            ast::Symbol name;
+            llvm::Value *value;
+            std::string type;
+            uint32_t shadowed;
+            uint32_t depth;
+        };
+
+        ScopeTable() { slots_.resize(64); }
+
+        size_t depth() const { return marks_.size(); }
+
+        void push()
+        {
+            marks_.push_back(static_cast<uint32_t>(bindings_.size()));
+        }
+
+        void pop()
+        {
+            if (marks_.empty())
+                return;
+            uint32_t mark = marks_.back();
+            marks_.pop_back();
+            while (bindings_.size() > mark)
+            {
+                Binding &b = bindings_.back();
+                find_slot(b.name)->head = b.shadowed;
+                bindings_.pop_back();
+            }
+        }
+
+        // Rebinding a name already bound in the current scope replaces it.
+        void bind(ast::Symbol name, llvm::Value *value, const std::string &type)
+        {
+            Slot *s = find_slot(name);
+            if (!s->used)
+            {
+                if ((used_ + 1) * 4 > slots_.size() * 3)
+                {
+                    grow();
+                    s = find_slot(name);
+                }
+                s->used = true;
+                s->key = name;
+                ++used_;
+            }
+
+            uint32_t d = static_cast<uint32_t>(marks_.size());
+            if (s->head != none && bindings_[s->head].depth == d)
+            {
+                bindings_[s->head].value = value;
+                bindings_[s->head].type = type;
+                return;
+            }
+
+            bindings_.push_back(Binding{name, value, type, s->head, d});
+            s->head = static_cast<uint32_t>(bindings_.size() - 1);
+        }
+
+        // The innermost binding of `name`, or null. Stays valid until its
+        // scope is popped.
+        Binding *lookup(ast::Symbol name)
+        {
+            const Slot *s = find_slot(name);
+            return s->head == none ? nullptr : &bindings_[s->head];
+        }
+
+    private:
+        static constexpr uint32_t none = UINT32_MAX;
+
+        struct Slot
+        {
+            ast::Symbol key;
+            uint32_t head = none;
+            bool used = false;
+        };
+
+        // Slots are never freed: a name whose bindings are all popped keeps
+        // its slot with an empty chain, ready for the next function.
+        std::vector<Slot> slots_;
+        size_t used_ = 0;
+        std::deque<Binding> bindings_;
+        std::vector<uint32_t> marks_;
+
+        Slot *find_slot(ast::Symbol name)
+        {
+            size_t mask = slots_.size() - 1;
+            size_t i = std::hash<ast::Symbol>()(name) & mask;
+            while (slots_[i].used && slots_[i].key != name)
+                i = (i + 1) & mask;
+            return &slots_[i];
+        }
+
+        void grow()
+        {
+            std::vector<Slot> old(slots_.size() * 2);
+            old.swap(slots_);
+            for (const Slot &s : old)
+                if (s.used)
+                    *find_slot(s.key) = s;
+        }
+    };
+}
@@ -17,13 +17,13 @@ Type *CodeGen::resolve_type_from_ast(const ast::Type *at)
     if (!at)
         return nullptr;
 
-    if (auto named = dynamic_cast<const ast::NamedType *>(at))
+    if (auto named = ast::as<ast::NamedType>(at))
     {
 
-        return resolve_type_by_name(named->name);
+        return resolve_type_by_name(named->name.str());
     }
 
-    if (auto ptr = dynamic_cast<const ast::PointerType *>(at))
+    if (auto ptr = ast::as<ast::PointerType>(at))
     {
         Type *inner = resolve_type_from_ast(ptr->base.get());
         if (!inner)
@@ -31,7 +31,7 @@ Type *CodeGen::resolve_type_from_ast(const ast::Type *at)
         return llvm::PointerType::getUnqual(inner);
     }
 
-    if (auto arr = dynamic_cast<const ast::ArrayType *>(at))
+    if (auto arr = ast::as<ast::ArrayType>(at))
     {
         llvm::Type *elem = resolve_type_from_ast(arr->elem.get());
         if (!elem)
@@ -40,7 +40,7 @@ Type *CodeGen::resolve_type_from_ast(const ast::Type *at)
         return llvm::PointerType::getUnqual(elem);
     }
 
-    if (auto f = dynamic_cast<const ast::FuncType *>(at))
+    if (auto f = ast::as<ast::FuncType>(at))
     {
 
         std::vector<llvm::Type *> params;
@@ -63,29 +63,29 @@ Type *CodeGen::resolve_type_from_ast(const ast::Type *at)
     return nullptr;
 }
 
-static std::string namedTypeName(const ast::Type *at)
+static ast::Symbol namedTypeName(const ast::Type *at)
 {
     if (!at)
-        return std::string();
+        return ast::Symbol();
 
-    if (auto named = dynamic_cast<const ast::NamedType *>(at))
+    if (auto named = ast::as<ast::NamedType>(at))
     {
         return named->name;
     }
-    if (auto ptr = dynamic_cast<const ast::PointerType *>(at))
+    if (auto ptr = ast::as<ast::PointerType>(at))
     {
         return namedTypeName(ptr->base.get());
     }
-    if (auto arr = dynamic_cast<const ast::ArrayType *>(at))
+    if (auto arr = ast::as<ast::ArrayType>(at))
     {
         return namedTypeName(arr->elem.get());
     }
-    if (auto ft = dynamic_cast<const ast::FuncType *>(at))
+    if (auto ft = ast::as<ast::FuncType>(at))
     {
         if (ft->ret)
             return namedTypeName(ft->ret.get());
     }
-    return std::string();
+    return ast::Symbol();
 }
 
 void CodeGen::prepare_struct_types(const ast::Program &prog)
@@ -95,7 +95,7 @@ void CodeGen::prepare_struct_types(const ast::Program &prog)
 
     for (const auto &dptr : prog.decls)
     {
-        if (auto sd = dynamic_cast<const ast::StructDecl *>(dptr.get()))
+        if (auto sd = ast::as<ast::StructDecl>(dptr.get()))
         {
             if (!sd->name.empty())
             {
@@ -103,7 +103,7 @@ void CodeGen::prepare_struct_types(const ast::Program &prog)
 
                 if (struct_types.find(sd->name) == struct_types.end())
                 {
-                    llvm::StructType *st = llvm::StructType::create(context, sd->name);
+                    llvm::StructType *st = llvm::StructType::create(context, sd->name.str());
                     struct_types[sd->name] = st;
                 }
             }
@@ -112,12 +112,12 @@ void CodeGen::prepare_struct_types(const ast::Program &prog)
 
     for (const auto &kv : struct_decls)
     {
-        const std::string name = kv.first;
+        const ast::Symbol name = kv.first;
         const ast::StructDecl *sd = kv.second;
         llvm::StructType *st = struct_types[name];
         if (!st)
         {
-            st = llvm::StructType::create(context, name);
+            st = llvm::StructType::create(context, name.str());
             struct_types[name] = st;
         }
 
@@ -215,28 +215,29 @@ llvm::Type *CodeGen::resolve_type_by_name(const std::string &typeName)
     if (typeName == "string")
         return llvm::PointerType::getUnqual(Type::getInt8Ty(context));
 
-    auto it = struct_types.find(typeName);
+    ast::Symbol sym = ast::intern(typeName);
+    auto it = struct_types.find(sym);
     if (it != struct_types.end())
         return it->second;
 
     llvm::StructType *st = llvm::StructType::create(context, typeName);
-    struct_types[typeName] = st;
+    struct_types[sym] = st;
     return st;
 }
 
-llvm::StructType *CodeGen::get_or_create_named_struct(const std::string &name)
+llvm::StructType *CodeGen::get_or_create_named_struct(ast::Symbol name)
 {
     if (name.empty())
         return nullptr;
     auto it = struct_types.find(name);
     if (it != struct_types.end())
         return it->second;
-    llvm::StructType *st = llvm::StructType::create(context, name);
+    llvm::StructType *st = llvm::StructType::create(context, name.str());
     struct_types[name] = st;
     return st;
 }
 
-int CodeGen::get_field_index(const ast::StructDecl *sd, const std::string &fieldName)
+int CodeGen::get_field_index(const ast::StructDecl *sd, ast::Symbol fieldName)
 {
     if (!sd)
         return -1;
@@ -261,14 +262,14 @@ llvm::Value *CodeGen::codegen_struct_literal(const ast::StructLiteral *sl)
         return nullptr;
     }
 
-    auto named = dynamic_cast<const ast::NamedType *>(sl->type.get());
+    auto named = ast::as<ast::NamedType>(sl->type.get());
     if (!named)
     {
         error("struct literal type must be a named type");
         return nullptr;
     }
 
-    const std::string &typeName = named->name;
+    const ast::Symbol typeName = named->name;
 
     auto it = struct_decls.find(typeName);
     if (it == struct_decls.end())
@@ -304,7 +305,7 @@ llvm::Value *CodeGen::codegen_struct_literal(const ast::StructLiteral *sl)
             int idx = get_field_index(sd, *init.name);
             if (idx < 0)
             {
-                error("unknown field '" + *init.name + "' in struct literal for " + typeName);
+                error("unknown field '" + init.name->str() + "' in struct literal for " + typeName);
                 return nullptr;
             }
             positional[idx] = &init;
@@ -412,7 +413,7 @@ llvm::Value *CodeGen::codegen_struct_literal(const ast::StructLiteral *sl)
 }
 
 static const ast::StructDecl *findStructDecl(
-    const std::unordered_map<std::string, const ast::StructDecl *> &struct_decls_map,
+    const std::unordered_map<ast::Symbol, const ast::StructDecl *> &struct_decls_map,
     llvm::StructType *st)
 {
     if (!st || !st->hasName())
@@ -420,13 +421,13 @@ static const ast::StructDecl *findStructDecl(
 
     std::string nm = st->getName().str();
 
-    auto it = struct_decls_map.find(nm);
+    auto it = struct_decls_map.find(ast::intern(nm));
     if (it != struct_decls_map.end())
         return it->second;
 
     for (const auto &kv : struct_decls_map)
     {
-        const std::string &declName = kv.first;
+        const std::string &declName = kv.first.str();
         if (nm == declName)
             return kv.second;
         if (nm.find(declName) != std::string::npos)
@@ -461,7 +462,7 @@ static const ast::StructDecl *findStructDecl(
     auto nm_toks = split_tokens(nm);
     for (const auto &kv : struct_decls_map)
     {
-        auto decl_toks = split_tokens(kv.first);
+        auto decl_toks = split_tokens(kv.first.str());
         for (const auto &nt : nm_toks)
         {
             for (const auto &dt : decl_toks)
@@ -485,7 +486,7 @@ Value *CodeGen::codegen_member_addr(const ast::MemberExpr *me)
 
     std::vector<const ast::MemberExpr *> chain;
     const ast::Expr *cur = me;
-    while (auto m = dynamic_cast<const ast::MemberExpr *>(cur))
+    while (auto m = ast::as<ast::MemberExpr>(cur))
     {
         chain.push_back(m);
         cur = m->object.get();
@@ -495,7 +496,7 @@ Value *CodeGen::codegen_member_addr(const ast::MemberExpr *me)
     StructType *curStructTy = nullptr;
     const ast::StructDecl *curDecl = nullptr;
 
-    if (auto id = dynamic_cast<const ast::Ident *>(cur))
+    if (auto id = ast::as<ast::Ident>(cur))
     {
         Value *objVal = lookup_local(id->name);
         if (!objVal)
@@ -527,7 +528,7 @@ Value *CodeGen::codegen_member_addr(const ast::MemberExpr *me)
         if (!objVal)
             return nullptr;
 
-        auto [st, ptr] = resolve_struct_and_ptr(objVal, std::string());
+        auto [st, ptr] = resolve_struct_and_ptr(objVal, ast::Symbol());
         if (st)
             curStructTy = st;
         basePtr = objVal;
@@ -603,7 +604,7 @@ Value *CodeGen::codegen_member_addr(const ast::MemberExpr *me)
     for (int ci = static_cast<int>(chain.size()) - 1; ci >= 0; --ci)
     {
         const ast::MemberExpr *m = chain[ci];
-        const std::string &fieldName = m->member;
+        const ast::Symbol fieldName = m->member;
 
         if (curStructTy && (!curDecl || (curDecl && curDecl->name != curStructTy->getName().str())))
         {
@@ -697,7 +698,7 @@ llvm::Value *CodeGen::codegen_member(const ast::MemberExpr *me)
 
     std::vector<const ast::MemberExpr *> chain;
     const ast::Expr *cur = me;
-    while (auto m = dynamic_cast<const ast::MemberExpr *>(cur))
+    while (auto m = ast::as<ast::MemberExpr>(cur))
     {
         chain.push_back(m);
         cur = m->object.get();
@@ -705,7 +706,7 @@ llvm::Value *CodeGen::codegen_member(const ast::MemberExpr *me)
 
     const ast::StructDecl *curDecl = nullptr;
 
-    if (auto id = dynamic_cast<const ast::Ident *>(cur))
+    if (auto id = ast::as<ast::Ident>(cur))
     {
         Value *objVal = lookup_local(id->name);
         if (!objVal)
@@ -717,7 +718,7 @@ llvm::Value *CodeGen::codegen_member(const ast::MemberExpr *me)
         auto [st, ptr] = resolve_struct_and_ptr(objVal, id->name);
         if (st && st->hasName())
         {
-            auto it = struct_decls.find(st->getName().str());
+            auto it = struct_decls.find(ast::intern(st->getName()));
             if (it != struct_decls.end())
                 curDecl = it->second;
         }
@@ -728,10 +729,10 @@ llvm::Value *CodeGen::codegen_member(const ast::MemberExpr *me)
         Value *objVal = codegen_expr(cur);
         if (!objVal)
             return nullptr;
-        auto [st, ptr] = resolve_struct_and_ptr(objVal, std::string());
+        auto [st, ptr] = resolve_struct_and_ptr(objVal, ast::Symbol());
         if (st && st->hasName())
         {
-            auto it = struct_decls.find(st->getName().str());
+            auto it = struct_decls.find(ast::intern(st->getName()));
             if (it != struct_decls.end())
                 curDecl = it->second;
         }
@@ -748,7 +749,7 @@ llvm::Value *CodeGen::codegen_member(const ast::MemberExpr *me)
     for (int i = static_cast<int>(chain.size()) - 1; i >= 0; --i)
     {
         const ast::MemberExpr *m = chain[i];
-        const std::string &fname = m->member;
+        const ast::Symbol fname = m->member;
 
         int idx = get_field_index(curDecl, fname);
         if (idx < 0)
@@ -768,7 +769,7 @@ llvm::Value *CodeGen::codegen_member(const ast::MemberExpr *me)
             break;
         }
 
-        std::string innerName = namedTypeName(field->type.get());
+        ast::Symbol innerName = namedTypeName(field->type.get());
         if (!innerName.empty())
         {
             auto it = struct_decls.find(innerName);
@@ -796,7 +797,7 @@ llvm::Value *CodeGen::codegen_member(const ast::MemberExpr *me)
                     auto st = dyn_cast<StructType>(ft);
                     if (st && st->hasName())
                     {
-                        auto it = struct_decls.find(st->getName().str());
+                        auto it = struct_decls.find(ast::intern(st->getName()));
                         if (it != struct_decls.end())
                         {
                             curDecl = it->second;
@@ -812,7 +813,7 @@ llvm::Value *CodeGen::codegen_member(const ast::MemberExpr *me)
                         auto st = dyn_cast<StructType>(pointee);
                         if (st && st->hasName())
                         {
-                            auto it = struct_decls.find(st->getName().str());
+                            auto it = struct_decls.find(ast::intern(st->getName()));
                             if (it != struct_decls.end())
                             {
                                 curDecl = it->second;
@@ -9,7 +9,7 @@
 using namespace llvm;
 using namespace codegen;
 
-llvm::StructType *CodeGen::get_struct_type_from_value(Value *v, const std::string &varname)
+llvm::StructType *CodeGen::get_struct_type_from_value(Value *v, ast::Symbol varname)
 {
     if (!v)
         return nullptr;
@@ -44,7 +44,7 @@ llvm::StructType *CodeGen::get_struct_type_from_value(Value *v, const std::strin
     return nullptr;
 }
 
-llvm::StructType *CodeGen::lookup_struct_type(const std::string &name)
+llvm::StructType *CodeGen::lookup_struct_type(ast::Symbol name)
 {
     if (name.empty())
         return nullptr;
@@ -56,7 +56,7 @@ llvm::StructType *CodeGen::lookup_struct_type(const std::string &name)
     return it->second;
 }
 
-std::pair<llvm::StructType *, llvm::Value *> CodeGen::deduce_struct_type_and_ptr(llvm::Value *v, const std::string &hintVarName)
+std::pair<llvm::StructType *, llvm::Value *> CodeGen::deduce_struct_type_and_ptr(llvm::Value *v, ast::Symbol hintVarName)
 {
     if (!v)
         return {nullptr, nullptr};
@@ -129,7 +129,7 @@ std::pair<llvm::StructType *, llvm::Value *> CodeGen::deduce_struct_type_and_ptr
     return {nullptr, nullptr};
 }
 
-std::pair<llvm::StructType *, llvm::Value *> CodeGen::resolve_struct_and_ptr(llvm::Value *v, const std::string &hintVarName)
+std::pair<llvm::StructType *, llvm::Value *> CodeGen::resolve_struct_and_ptr(llvm::Value *v, ast::Symbol hintVarName)
 {
 
     if (!v)
@@ -284,7 +284,7 @@ std::pair<llvm::StructType *, llvm::Value *> CodeGen::resolve_struct_and_ptr(llv
     {
         if (kv.second->hasName())
         {
-            return {lookup_struct_type(kv.second->getName().str()), v};
+            return {lookup_struct_type(ast::intern(kv.second->getName())), v};
         }
     }
 
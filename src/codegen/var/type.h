@@ -43,8 +43,9 @@ llvm::Type *CodeGen::getLLVMType(const std::string &typeName)
     }
     else
     {
-        std::cout << "Looking up type: " << pt.base << std::endl;
-        ty = lookup_struct_type(pt.base);
+        if (irdebug)
+            std::cout << "Looking up type: " << pt.base << std::endl;
+        ty = lookup_struct_type(ast::intern(pt.base));
         if (!ty)
         {
             throw std::runtime_error("Unknown type: " + pt.base);
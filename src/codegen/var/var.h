@@ -17,9 +17,9 @@ std::string CodeGen::resolve_type_name(ast::Type *tp)
     while (tp)
     {
 
-        if (auto *nt = dynamic_cast<ast::NamedType *>(tp))
+        if (auto *nt = ast::as<ast::NamedType>(tp))
         {
-            std::string result = nt->name;
+            std::string result = nt->name.str();
 
             for (int i = 0; i < array_depth; i++)
                 result += "[]";
@@ -30,14 +30,14 @@ std::string CodeGen::resolve_type_name(ast::Type *tp)
             return result;
         }
 
-        if (auto *at = dynamic_cast<ast::ArrayType *>(tp))
+        if (auto *at = ast::as<ast::ArrayType>(tp))
         {
             array_depth++;
             tp = at->elem.get();
             continue;
         }
 
-        if (auto *pt = dynamic_cast<ast::PointerType *>(tp))
+        if (auto *pt = ast::as<ast::PointerType>(tp))
         {
             pointer_depth++;
             tp = pt->base.get();
@@ -55,9 +55,9 @@ static bool is_primitive_or_empty_type(ast::Type *t)
     if (!t)
         return true;
 
-    if (auto *nt = dynamic_cast<ast::NamedType *>(t))
+    if (auto *nt = ast::as<ast::NamedType>(t))
     {
-        const std::string &nm = nt->name;
+        const ast::Symbol nm = nt->name;
         if (nm.empty())
             return true;
         if (nm == "i32" || nm == "f32" || nm == "bool")
@@ -77,7 +77,8 @@ Value *CodeGen::codegen_vardecl(const ast::VarDecl *vd)
 
     std::string t = resolve_type_name(tp);
 
-    std::cout << "VarDecl: " << vd->name << " type=" << t << std::endl;
+    if (irdebug)
+        std::cout << "VarDecl: " << vd->name << " type=" << t << std::endl;
 
     if (Type *tx = getLLVMType(t))
     {
@@ -87,7 +88,7 @@ Value *CodeGen::codegen_vardecl(const ast::VarDecl *vd)
 
     if (vd->init)
     {
-        if (auto sl = dynamic_cast<const ast::StructLiteral *>(vd->init.get()))
+        if (auto sl = ast::as<ast::StructLiteral>(vd->init.get()))
         {
             llvm::Value *addr = codegen_struct_literal(sl);
             if (!addr)
@@ -97,7 +98,7 @@ Value *CodeGen::codegen_vardecl(const ast::VarDecl *vd)
         }
         else
         {
-            if (auto alit = dynamic_cast<const ast::ArrayLiteral *>(vd->init.get()))
+            if (auto alit = ast::as<ast::ArrayLiteral>(vd->init.get()))
             {
                 ast::Type *tp = alit->array_type.get();
                 if (!is_primitive_or_empty_type(tp))
@@ -125,11 +126,14 @@ Value *CodeGen::codegen_vardecl(const ast::VarDecl *vd)
                 t = "i32";
             }
 
-            std::cout << "VarDecl init type: ";
-            ty->print(llvm::outs());
-            std::cout << std::endl;
+            if (irdebug)
+            {
+                std::cout << "VarDecl init type: ";
+                ty->print(llvm::outs());
+                std::cout << std::endl;
+            }
 
-            Value *alloca = create_entry_alloca(F, ty, vd->name);
+            Value *alloca = create_entry_alloca(F, ty, vd->name.str());
             bind_local(vd->name, t, alloca);
 
             Value *storeVal = initV;
@@ -151,7 +155,7 @@ Value *CodeGen::codegen_vardecl(const ast::VarDecl *vd)
     }
     else
     {
-        Value *alloca = create_entry_alloca(F, ty, vd->name);
+        Value *alloca = create_entry_alloca(F, ty, vd->name.str());
         builder.CreateStore(Constant::getNullValue(ty), alloca);
         bind_local(vd->name, t, alloca);
         return alloca;
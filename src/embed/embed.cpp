@@ -0,0 +1,172 @@
+#include "embed.h"
+#include "../lexer/lexer.h"
+#include "../lexer/source.h"
+#include "../parser/parser.h"
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <atomic>
+
+namespace embed
+{
+    struct Context::Impl
+    {
+        Options opts;
+        std::unique_ptr<llvm::orc::LLJIT> jit;
+        std::string jit_error;
+        std::atomic<unsigned> next_id{0};
+
+        // Parses every source and generates one module, or returns null
+        // with the reasons in `diags`.
+        std::unique_ptr<codegen::CodeGen> build(const std::vector<SourceFile> &sources,
+                                                const codegen::TargetConfig *target,
+                                                std::vector<Diagnostic> &diags);
+    };
+
+    struct Program::State
+    {
+        Context::Impl &ctx;
+        llvm::orc::JITDylib &dylib;
+    };
+
+    std::unique_ptr<codegen::CodeGen> Context::Impl::build(const std::vector<SourceFile> &sources,
+                                                           const codegen::TargetConfig *target,
+                                                           std::vector<Diagnostic> &diags)
+    {
+        size_t errors = diags.size();
+        ast::Program merged;
+        std::vector<ast::Ptr<ast::Decl>> struct_decls;
+        std::vector<ast::Ptr<ast::Decl>> other_decls;
+
+        for (const auto &src : sources)
+        {
+            auto report = [&diags, &src](int line, int col, const std::string &msg)
+            {
+                diags.push_back({src.name, line, col, msg});
+            };
+
+            auto buffer = lex::SourceBuffer::from_string(src.text, src.name);
+            lex::Lexer lx(buffer->view(), report);
+            path::Parser parser(lx, report);
+            auto prog = parser.parse_program();
+            if (!prog)
+            {
+                diags.push_back({src.name, 0, 0, "parsing failed"});
+                return nullptr;
+            }
+
+            merged.adopt(*prog);
+            for (auto &d : prog->decls)
+            {
+                if (d->kind == ast::NodeKind::StructDecl)
+                    struct_decls.push_back(d);
+                else
+                    other_decls.push_back(d);
+            }
+        }
+        if (diags.size() != errors)
+            return nullptr;
+
+        for (auto &d : struct_decls)
+            merged.decls.push_back(d);
+        for (auto &d : other_decls)
+            merged.decls.push_back(d);
+
+        auto cg = std::make_unique<codegen::CodeGen>("embed");
+        cg->set_error_handler([&diags](const std::string &msg)
+                              { diags.push_back({"", 0, 0, msg}); });
+        if (target && !cg->set_target(*target))
+            return nullptr;
+        if (!cg->generate(merged) || diags.size() != errors)
+            return nullptr;
+        cg->optimize(opts.opt_level);
+        return cg;
+    }
+
+    Context::Context(Options opts) : impl_(std::make_unique<Impl>())
+    {
+        impl_->opts = std::move(opts);
+        codegen::initialize_native_target();
+
+        // A failure here is reported by the first compile call.
+        auto jit = llvm::orc::LLJITBuilder().create();
+        if (jit)
+            impl_->jit = std::move(*jit);
+        else
+            impl_->jit_error = llvm::toString(jit.takeError());
+    }
+
+    Context::~Context() = default;
+
+    std::unique_ptr<Program> Context::compile(const std::vector<SourceFile> &sources, std::vector<Diagnostic> &diags)
+    {
+        auto fail = [&diags](const std::string &msg) -> std::unique_ptr<Program>
+        {
+            diags.push_back({"", 0, 0, msg});
+            return nullptr;
+        };
+
+        if (!impl_->jit)
+            return fail("jit: " + impl_->jit_error);
+
+        auto cg = impl_->build(sources, nullptr, diags);
+        if (!cg)
+            return nullptr;
+
+        auto ctx = std::make_unique<llvm::LLVMContext>();
+        auto module = cg->copy_module(*ctx);
+        if (!module)
+            return fail("jit: could not copy the module");
+
+        // Each program gets a dylib of its own, so programs can define the
+        // same names and be dropped independently.
+        llvm::orc::LLJIT &jit = *impl_->jit;
+        auto dylib = jit.createJITDylib("program." + std::to_string(impl_->next_id++));
+        if (!dylib)
+            return fail("jit: " + llvm::toString(dylib.takeError()));
+
+        auto host = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(jit.getDataLayout().getGlobalPrefix());
+        if (!host)
+            return fail("jit: " + llvm::toString(host.takeError()));
+        dylib->addGenerator(std::move(*host));
+
+        if (llvm::Error e = jit.addIRModule(*dylib, llvm::orc::ThreadSafeModule(std::move(module), std::move(ctx))))
+            return fail("jit: " + llvm::toString(std::move(e)));
+
+        auto state = std::make_unique<Program::State>(Program::State{*impl_, *dylib});
+        return std::unique_ptr<Program>(new Program(std::move(state)));
+    }
+
+    bool Context::compile_object(const std::vector<SourceFile> &sources, std::vector<char> &object, std::vector<Diagnostic> &diags)
+    {
+        const codegen::TargetConfig &target = impl_->opts.target;
+        bool custom = !target.triple.empty() || !target.cpu.empty() || !target.features.empty();
+        auto cg = impl_->build(sources, custom ? &target : nullptr, diags);
+        if (!cg)
+            return false;
+
+        llvm::SmallVector<char, 0> buf;
+        if (!cg->write_native_object(buf))
+            return false;
+        object.assign(buf.begin(), buf.end());
+        return true;
+    }
+
+    Program::Program(std::unique_ptr<State> state) : state_(std::move(state)) {}
+
+    Program::~Program()
+    {
+        llvm::consumeError(state_->ctx.jit->getExecutionSession().removeJITDylib(state_->dylib));
+    }
+
+    void *Program::lookup(const std::string &name) const
+    {
+        // The first lookup compiles the program.
+        auto addr = state_->ctx.jit->lookup(state_->dylib, name);
+        if (!addr)
+        {
+            llvm::consumeError(addr.takeError());
+            return nullptr;
+        }
+        return addr->toPtr<void *>();
+    }
+}
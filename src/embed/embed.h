@@ -0,0 +1,87 @@
+#pragma once
+#include "../codegen/codegen.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace embed
+{
+    // One problem found while compiling. `file` is the SourceFile name and
+    // is empty, like line and column, for errors past the parser.
+    struct Diagnostic
+    {
+        std::string file;
+        int line = 0;
+        int col = 0;
+        std::string message;
+    };
+
+    struct SourceFile
+    {
+        std::string name;
+        std::string text;
+    };
+
+    struct Options
+    {
+        codegen::OptLevel opt_level = codegen::OptLevel::O2;
+        // Only used by compile_object; JIT code always targets the host.
+        codegen::TargetConfig target;
+    };
+
+    class Program;
+
+    // Compiles ECPL from memory for a host application. LLVM is set up once
+    // per process and one JIT serves every Program, so compiling costs the
+    // compile itself, and calling a compiled function is a plain call.
+    // compile and compile_object may be called from several threads.
+    class Context
+    {
+    public:
+        explicit Context(Options opts = {});
+        ~Context();
+
+        Context(const Context &) = delete;
+        Context &operator=(const Context &) = delete;
+
+        // JIT-compiles the sources as one program. Returns null and fills
+        // `diags` on failure. The Program must not outlive the Context.
+        std::unique_ptr<Program> compile(const std::vector<SourceFile> &sources, std::vector<Diagnostic> &diags);
+
+        // Object file bytes for Options::target.
+        bool compile_object(const std::vector<SourceFile> &sources, std::vector<char> &object, std::vector<Diagnostic> &diags);
+
+        struct Impl;
+
+    private:
+        std::unique_ptr<Impl> impl_;
+    };
+
+    // Code from one compile call. Only pub functions and main can be looked
+    // up; everything else is internal to the program.
+    class Program
+    {
+    public:
+        ~Program();
+
+        Program(const Program &) = delete;
+        Program &operator=(const Program &) = delete;
+
+        // Address of `name`, or null if the program does not export it.
+        void *lookup(const std::string &name) const;
+
+        template <typename Fn>
+        Fn *function(const std::string &name) const
+        {
+            return reinterpret_cast<Fn *>(lookup(name));
+        }
+
+    private:
+        friend class Context;
+        struct State;
+
+        explicit Program(std::unique_ptr<State> state);
+
+        std::unique_ptr<State> state_;
+    };
+}
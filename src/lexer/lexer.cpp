@@ -1,42 +1,130 @@
 #include "lexer.h"
+#include "scan.h"
 #include <cctype>
-#include <sstream>
-#include <iomanip>
 #include <algorithm>
 
 namespace lex
 {
-    static const std::unordered_map<std::string, TokenType> keywords = {
-        {"import", TokenType::KW_IMPORT},
-        {"pub", TokenType::KW_PUB},
-        {"fn", TokenType::KW_FN},
-        {"struct", TokenType::KW_STRUCT},
-        {"enum", TokenType::KW_ENUM},
-        {"const", TokenType::KW_CONST},
-        {"if", TokenType::KW_IF},
-        {"else", TokenType::KW_ELSE},
-        {"match", TokenType::KW_MATCH},
-        {"for", TokenType::KW_FOR},
-        {"in", TokenType::KW_IN},
-        {"return", TokenType::KW_RETURN},
-        {"break", TokenType::KW_BREAK},
-        {"continue", TokenType::KW_CONTINUE},
-        {"true", TokenType::KW_TRUE},
-        {"false", TokenType::KW_FALSE},
-        {"byte", TokenType::KW_BYTE},
-        {"package", TokenType::KW_PACKAGE},
-        {"...", TokenType::ELLIPSIS},
-    };
-
-    Lexer::Lexer(const std::string &src_, std::function<void(int, int, const std::string &)> error_cb_)
+    // Keyword recognition without hashing or allocating: dispatch on length,
+    // then on the first character, then compare the remaining bytes.
+    static TokenType keyword_type(std::string_view s)
+    {
+        switch (s.size())
+        {
+        case 2:
+            switch (s[0])
+            {
+            case 'a':
+                return s == "as" ? TokenType::KW_AS : TokenType::IDENT;
+            case 'f':
+                return s == "fn" ? TokenType::KW_FN : TokenType::IDENT;
+            case 'g':
+                return s == "go" ? TokenType::KW_GO : TokenType::IDENT;
+            case 'i':
+                if (s[1] == 'f')
+                    return TokenType::KW_IF;
+                if (s[1] == 'n')
+                    return TokenType::KW_IN;
+                if (s[1] == 's')
+                    return TokenType::KW_IS;
+                return TokenType::IDENT;
+            case 'o':
+                return s == "or" ? TokenType::KW_OR : TokenType::IDENT;
+            }
+            break;
+        case 3:
+            switch (s[0])
+            {
+            case 'f':
+                return s == "for" ? TokenType::KW_FOR : TokenType::IDENT;
+            case 'm':
+                return s == "mut" ? TokenType::KW_MUT : TokenType::IDENT;
+            case 'p':
+                return s == "pub" ? TokenType::KW_PUB : TokenType::IDENT;
+            }
+            break;
+        case 4:
+            switch (s[0])
+            {
+            case 'b':
+                return s == "byte" ? TokenType::KW_BYTE : TokenType::IDENT;
+            case 'e':
+                if (s == "else")
+                    return TokenType::KW_ELSE;
+                if (s == "enum")
+                    return TokenType::KW_ENUM;
+                return TokenType::IDENT;
+            case 'n':
+                return s == "none" ? TokenType::KW_NONE : TokenType::IDENT;
+            case 't':
+                if (s == "true")
+                    return TokenType::KW_TRUE;
+                if (s == "type")
+                    return TokenType::KW_TYPE;
+                return TokenType::IDENT;
+            }
+            break;
+        case 5:
+            switch (s[0])
+            {
+            case 'b':
+                return s == "break" ? TokenType::KW_BREAK : TokenType::IDENT;
+            case 'c':
+                return s == "const" ? TokenType::KW_CONST : TokenType::IDENT;
+            case 'd':
+                return s == "defer" ? TokenType::KW_DEFER : TokenType::IDENT;
+            case 'f':
+                return s == "false" ? TokenType::KW_FALSE : TokenType::IDENT;
+            case 'm':
+                return s == "match" ? TokenType::KW_MATCH : TokenType::IDENT;
+            }
+            break;
+        case 6:
+            switch (s[0])
+            {
+            case 'i':
+                return s == "import" ? TokenType::KW_IMPORT : TokenType::IDENT;
+            case 'm':
+                return s == "module" ? TokenType::KW_MODULE : TokenType::IDENT;
+            case 'r':
+                return s == "return" ? TokenType::KW_RETURN : TokenType::IDENT;
+            case 's':
+                if (s == "struct")
+                    return TokenType::KW_STRUCT;
+                if (s == "select")
+                    return TokenType::KW_SELECT;
+                if (s == "switch")
+                    return TokenType::KW_SWITCH;
+                return TokenType::IDENT;
+            }
+            break;
+        case 7:
+            return s == "package" ? TokenType::KW_PACKAGE : TokenType::IDENT;
+        case 8:
+            if (s == "continue")
+                return TokenType::KW_CONTINUE;
+            if (s == "importas")
+                return TokenType::KW_IMPORTAS;
+            break;
+        case 9:
+            return s == "interface" ? TokenType::KW_INTERFACE : TokenType::IDENT;
+        }
+        return TokenType::IDENT;
+    }
+
+    Lexer::Lexer(std::string_view src_, std::function<void(int, int, const std::string &)> error_cb_)
         : src(src_), error_cb(error_cb_)
     {
-        last_pos.line = line;
-        last_pos.column = column;
+        last_pos = here();
     }
 
     bool Lexer::is_at_end() const { return current >= src.size(); }
 
+    Position Lexer::here() const
+    {
+        return Position{line, static_cast<int>(current - line_start) + 1};
+    }
+
     char Lexer::advance()
     {
         if (is_at_end())
@@ -45,11 +133,7 @@ namespace lex
         if (c == '\n')
         {
             ++line;
-            column = 1;
-        }
-        else
-        {
-            ++column;
+            line_start = current;
         }
         return c;
     }
@@ -89,11 +173,7 @@ namespace lex
         if (expected == '\n')
         {
             ++line;
-            column = 1;
-        }
-        else
-        {
-            ++column;
+            line_start = current;
         }
         return true;
     }
@@ -101,10 +181,13 @@ namespace lex
     void Lexer::emit_error(const std::string &msg)
     {
         if (error_cb)
-            error_cb(line, column, msg);
+        {
+            Position p = here();
+            error_cb(p.line, p.column, msg);
+        }
     }
 
-    Token Lexer::make_token(TokenType type, const std::string &lexeme, Position start, Position end)
+    Token Lexer::make_token(TokenType type, std::string_view lexeme, Position start, Position end)
     {
         Token t;
         t.type = type;
@@ -114,76 +197,63 @@ namespace lex
         return t;
     }
 
-    Token Lexer::make_token_single(TokenType type, const std::string &lexeme, Position start)
+    Token Lexer::make_token_single(TokenType type, std::string_view lexeme, Position start)
     {
         Position end = start;
         end.column = start.column + static_cast<int>(lexeme.size()) - 1;
         return make_token(type, lexeme, start, end);
     }
 
-    void Lexer::skip_whitespace_and_comments(std::vector<Token> &out, bool emit_newline)
+    bool Lexer::skip_whitespace_and_comments(Token *first_newline)
     {
+        bool saw_newline = false;
         for (;;)
         {
-            char c = peek_char();
-            if (c == ' ' || c == '\t' || c == '\r')
-            {
-                advance();
-                continue;
-            }
-            if (c == '\n')
-            {
+            size_t st = current;
+            current = scan::skip_space(src.data(), current, src.size());
 
-                Position p{line, column};
-                advance();
-                Position q{line, column};
-                if (emit_newline)
+            // Line bookkeeping for the skipped run only has to visit its newlines.
+            for (size_t nl = scan::find_newline(src.data(), st, current); nl < current;
+                 nl = scan::find_newline(src.data(), nl + 1, current))
+            {
+                if (!saw_newline && first_newline)
                 {
-                    out.push_back(make_token(TokenType::NEWLINE, "\n", p, q));
+                    Position p{line, static_cast<int>(nl - line_start) + 1};
+                    Position q{line + 1, 1};
+                    *first_newline = make_token(TokenType::NEWLINE, src.substr(nl, 1), p, q);
                 }
-                continue;
+                saw_newline = true;
+                ++line;
+                line_start = nl + 1;
             }
 
+            char c = peek_char();
+
             if (c == '/')
             {
                 if (peek_char(1) == '/')
                 {
 
-                    Position p{line, column};
-
-                    advance();
-                    advance();
-                    std::string lex = "//";
-                    while (!is_at_end() && peek_char() != '\n')
-                    {
-                        lex.push_back(advance());
-                    }
-                    Position q{line, column};
-
+                    current = scan::find_newline(src.data(), current + 2, src.size());
                     continue;
                 }
                 else if (peek_char(1) == '*')
                 {
 
-                    Position p{line, column};
                     advance();
                     advance();
                     int depth = 1;
-                    std::string lex = "/*";
                     while (!is_at_end() && depth > 0)
                     {
                         char ch = advance();
-                        lex.push_back(ch);
                         if (ch == '/' && peek_char() == '*')
                         {
                             advance();
-                            lex.push_back('*');
                             ++depth;
                         }
                         else if (ch == '*' && peek_char() == '/')
                         {
                             advance();
-                            lex.push_back('/');
                             --depth;
                         }
                     }
@@ -196,101 +266,110 @@ namespace lex
             }
             break;
         }
+        return saw_newline;
     }
 
     Token Lexer::next_token()
     {
-        std::vector<Token> tmp;
-        skip_whitespace_and_comments(tmp, true);
-
-        if (!tmp.empty())
+        if (!lookahead.empty())
         {
-            Token t = tmp.front();
-
+            Token t = lookahead.front();
+            lookahead.pop_front();
             return t;
         }
+        return lex_token();
+    }
+
+    Token Lexer::lex_token()
+    {
+        Token newline;
+        if (skip_whitespace_and_comments(&newline))
+        {
+            return newline;
+        }
         if (is_at_end())
         {
-            Position p{line, column};
-            return make_token(TokenType::EOF_TOKEN, "", p, p);
+            Position p = here();
+            return make_token(TokenType::EOF_TOKEN, src.substr(current, 0), p, p);
         }
         return scan_token();
     }
 
     Token Lexer::scan_token()
     {
-        Position start{line, column};
+        size_t st = current;
+        Position start = here();
         char c = advance();
 
         switch (c)
         {
         case '(':
-            return make_token_single(TokenType::LPAREN, "(", start);
+            return make_token_single(TokenType::LPAREN, src.substr(st, current - st), start);
         case ')':
-            return make_token_single(TokenType::RPAREN, ")", start);
+            return make_token_single(TokenType::RPAREN, src.substr(st, current - st), start);
         case '{':
-            return make_token_single(TokenType::LBRACE, "{", start);
+            return make_token_single(TokenType::LBRACE, src.substr(st, current - st), start);
         case '}':
-            return make_token_single(TokenType::RBRACE, "}", start);
+            return make_token_single(TokenType::RBRACE, src.substr(st, current - st), start);
         case '[':
-            return make_token_single(TokenType::LBRACK, "[", start);
+            return make_token_single(TokenType::LBRACK, src.substr(st, current - st), start);
         case ']':
-            return make_token_single(TokenType::RBRACK, "]", start);
+            return make_token_single(TokenType::RBRACK, src.substr(st, current - st), start);
         case ',':
-            return make_token_single(TokenType::COMMA, ",", start);
+            return make_token_single(TokenType::COMMA, src.substr(st, current - st), start);
         case '.':
-            return make_token_single(TokenType::DOT, ".", start);
+            return make_token_single(TokenType::DOT, src.substr(st, current - st), start);
         case ':':
         {
             if (peek_char() == '=')
             {
                 advance();
-                return make_token(TokenType::ASSIGN, ":=", start, Position{line, column});
+                return make_token(TokenType::ASSIGN, src.substr(st, current - st), start, here());
             }
-            return make_token_single(TokenType::COLON, ":", start);
+            return make_token_single(TokenType::COLON, src.substr(st, current - st), start);
         }
         case ';':
-            return make_token_single(TokenType::SEMICOLON, ";", start);
+            return make_token_single(TokenType::SEMICOLON, src.substr(st, current - st), start);
         case '?':
-            return make_token_single(TokenType::QUESTION, "?", start);
+            return make_token_single(TokenType::QUESTION, src.substr(st, current - st), start);
         case '+':
             if (peek_char() == '=')
             {
                 advance();
-                return make_token(TokenType::PLUS_ASSIGN, "+=", start, Position{line, column});
+                return make_token(TokenType::PLUS_ASSIGN, src.substr(st, current - st), start, here());
             }
 
             if (peek_char() == '+')
             {
                 advance();
-                return make_token(TokenType::PLUSPLUS, "++", start, Position{line, column});
+                return make_token(TokenType::PLUSPLUS, src.substr(st, current - st), start, here());
             }
 
-            return make_token_single(TokenType::PLUS, "+", start);
+            return make_token_single(TokenType::PLUS, src.substr(st, current - st), start);
         case '-':
             if (peek_char() == '=')
             {
                 advance();
-                return make_token(TokenType::MINUS_ASSIGN, "-=", start, Position{line, column});
+                return make_token(TokenType::MINUS_ASSIGN, src.substr(st, current - st), start, here());
             }
             if (peek_char() == '>')
             {
                 advance();
-                return make_token(TokenType::ARROW, "->", start, Position{line, column});
+                return make_token(TokenType::ARROW, src.substr(st, current - st), start, here());
             }
 
             if (peek_char() == '-')
             {
                 advance();
-                return make_token(TokenType::MINUSMINUS, "--", start, Position{line, column});
+                return make_token(TokenType::MINUSMINUS, src.substr(st, current - st), start, here());
             }
 
-            return make_token_single(TokenType::MINUS, "-", start);
+            return make_token_single(TokenType::MINUS, src.substr(st, current - st), start);
         case '*':
             if (peek_char() == '=')
             {
                 advance();
-                return make_token(TokenType::MUL_ASSIGN, "*=", start, Position{line, column});
+                return make_token(TokenType::MUL_ASSIGN, src.substr(st, current - st), start, here());
             }
 
             {
@@ -298,32 +377,32 @@ namespace lex
                 if (is_ident_start(next) || next == '*' || next == '&' || next == '(' || next == '[')
                 {
 
-                    return make_token_single(TokenType::DEREF, "*", start);
+                    return make_token_single(TokenType::DEREF, src.substr(st, current - st), start);
                 }
 
-                return make_token_single(TokenType::STAR, "*", start);
+                return make_token_single(TokenType::STAR, src.substr(st, current - st), start);
             }
         case '/':
             if (peek_char() == '=')
             {
                 advance();
-                return make_token(TokenType::DIV_ASSIGN, "/=", start, Position{line, column});
+                return make_token(TokenType::DIV_ASSIGN, src.substr(st, current - st), start, here());
             }
-            return make_token_single(TokenType::SLASH, "/", start);
+            return make_token_single(TokenType::SLASH, src.substr(st, current - st), start);
         case '%':
             if (peek_char() == '=')
             {
                 advance();
-                return make_token(TokenType::MOD_ASSIGN, "%=", start, Position{line, column});
+                return make_token(TokenType::MOD_ASSIGN, src.substr(st, current - st), start, here());
             }
-            return make_token_single(TokenType::PERCENT, "%", start);
+            return make_token_single(TokenType::PERCENT, src.substr(st, current - st), start);
         case '^':
-            return make_token_single(TokenType::CARET, "^", start);
+            return make_token_single(TokenType::CARET, src.substr(st, current - st), start);
         case '&':
             if (peek_char() == '&')
             {
                 advance();
-                return make_token(TokenType::AND, "&&", start, Position{line, column});
+                return make_token(TokenType::AND, src.substr(st, current - st), start, here());
             }
 
             {
@@ -331,63 +410,63 @@ namespace lex
                 if (is_ident_start(next) || next == '*' || next == '&' || next == '(' || next == '[')
                 {
 
-                    return make_token_single(TokenType::ADDRESS_OF, "&", start);
+                    return make_token_single(TokenType::ADDRESS_OF, src.substr(st, current - st), start);
                 }
 
-                return make_token_single(TokenType::BIT_AND, "&", start);
+                return make_token_single(TokenType::BIT_AND, src.substr(st, current - st), start);
             }
         case '|':
             if (peek_char() == '|')
             {
                 advance();
-                return make_token(TokenType::OR, "||", start, Position{line, column});
+                return make_token(TokenType::OR, src.substr(st, current - st), start, here());
             }
-            return make_token_single(TokenType::BIT_OR, "|", start);
+            return make_token_single(TokenType::BIT_OR, src.substr(st, current - st), start);
         case '!':
             if (peek_char() == '=')
             {
                 advance();
-                return make_token(TokenType::NEQ, "!=", start, Position{line, column});
+                return make_token(TokenType::NEQ, src.substr(st, current - st), start, here());
             }
-            return make_token_single(TokenType::BANG, "!", start);
+            return make_token_single(TokenType::BANG, src.substr(st, current - st), start);
         case '~':
-            return make_token_single(TokenType::TILDE, "~", start);
+            return make_token_single(TokenType::TILDE, src.substr(st, current - st), start);
         case '=':
             if (peek_char() == '=')
             {
                 advance();
-                return make_token(TokenType::EQ, "==", start, Position{line, column});
+                return make_token(TokenType::EQ, src.substr(st, current - st), start, here());
             }
             if (peek_char() == '>')
             {
                 advance();
-                return make_token(TokenType::ARROW_R, "=>", start, Position{line, column});
+                return make_token(TokenType::ARROW_R, src.substr(st, current - st), start, here());
             }
-            return make_token_single(TokenType::ASSIGN, "=", start);
+            return make_token_single(TokenType::ASSIGN, src.substr(st, current - st), start);
         case '<':
             if (peek_char() == '=')
             {
                 advance();
-                return make_token(TokenType::LE, "<=", start, Position{line, column});
+                return make_token(TokenType::LE, src.substr(st, current - st), start, here());
             }
             if (peek_char() == '<')
             {
                 advance();
-                return make_token(TokenType::SHL, "<<", start, Position{line, column});
+                return make_token(TokenType::SHL, src.substr(st, current - st), start, here());
             }
-            return make_token_single(TokenType::LT, "<", start);
+            return make_token_single(TokenType::LT, src.substr(st, current - st), start);
         case '>':
             if (peek_char() == '=')
             {
                 advance();
-                return make_token(TokenType::GE, ">=", start, Position{line, column});
+                return make_token(TokenType::GE, src.substr(st, current - st), start, here());
             }
             if (peek_char() == '>')
             {
                 advance();
-                return make_token(TokenType::SHR, ">>", start, Position{line, column});
+                return make_token(TokenType::SHR, src.substr(st, current - st), start, here());
             }
-            return make_token_single(TokenType::GT, ">", start);
+            return make_token_single(TokenType::GT, src.substr(st, current - st), start);
         case '\'':
             return char_literal(start);
         case '"':
@@ -398,43 +477,30 @@ namespace lex
             {
 
                 --current;
-                if (column > 1)
-                    --column;
                 return number_literal(start);
             }
             if (is_ident_start(c))
             {
 
                 --current;
-                if (column > 1)
-                    --column;
                 return identifier_or_keyword(start);
             }
             break;
         }
 
-        std::string s;
-        s.push_back(c);
         emit_error(std::string("unexpected character '") + c + "'");
-        return make_token(TokenType::ILLEGAL, s, start, Position{line, column});
+        return make_token(TokenType::ILLEGAL, src.substr(st, current - st), start, here());
     }
 
     Token Lexer::identifier_or_keyword(Position start)
     {
         size_t st = current;
 
-        char c = advance();
-        while (is_ident_part(peek_char()))
-            advance();
+        current = scan::skip_ident(src.data(), current + 1, src.size());
         size_t ed = current;
-        std::string lex = src.substr(st, ed - st);
+        std::string_view lex = src.substr(st, ed - st);
 
-        auto it = keywords.find(lex);
-        if (it != keywords.end())
-        {
-            return make_token(it->second, lex, start, Position{line, column});
-        }
-        return make_token(TokenType::IDENT, lex, start, Position{line, column});
+        return make_token(keyword_type(lex), lex, start, here());
     }
 
     Token Lexer::number_literal(Position start)
@@ -448,8 +514,8 @@ namespace lex
             advance();
             while (std::isxdigit(static_cast<unsigned char>(peek_char())))
                 advance();
-            std::string lex = src.substr(st, current - st);
-            return make_token(TokenType::INT, lex, start, Position{line, column});
+            std::string_view lex = src.substr(st, current - st);
+            return make_token(TokenType::INT, lex, start, here());
         }
 
         else if (peek_char() == '0' && (peek_char(1) | 0x20) == 'b')
@@ -458,8 +524,8 @@ namespace lex
             advance();
             while (peek_char() == '0' || peek_char() == '1')
                 advance();
-            std::string lex = src.substr(st, current - st);
-            return make_token(TokenType::INT, lex, start, Position{line, column});
+            std::string_view lex = src.substr(st, current - st);
+            return make_token(TokenType::INT, lex, start, here());
         }
 
         else if (peek_char() == '0' && std::isdigit(static_cast<unsigned char>(peek_char(1))))
@@ -489,8 +555,8 @@ namespace lex
             {
                 emit_error("invalid digit in octal literal");
             }
-            std::string lex = src.substr(st, current - st);
-            return make_token(TokenType::INT, lex, start, Position{line, column});
+            std::string_view lex = src.substr(st, current - st);
+            return make_token(TokenType::INT, lex, start, here());
         }
         else
         {
@@ -518,32 +584,30 @@ namespace lex
                 while (std::isdigit(static_cast<unsigned char>(peek_char())))
                     advance();
             }
-            std::string lex = src.substr(st, current - st);
-            return make_token(is_float ? TokenType::FLOAT : TokenType::INT, lex, start, Position{line, column});
+            std::string_view lex = src.substr(st, current - st);
+            return make_token(is_float ? TokenType::FLOAT : TokenType::INT, lex, start, here());
         }
     }
 
     Token Lexer::string_literal(Position start, char quote)
     {
         size_t st = current - 1;
-        std::ostringstream sb;
-        sb << quote;
         bool is_raw = (quote == '`');
         if (is_raw)
         {
 
             while (!is_at_end() && peek_char() != '`')
             {
-                sb << advance();
+                advance();
             }
             if (is_at_end())
             {
                 emit_error("unterminated raw string literal");
-                return make_token(TokenType::ILLEGAL, sb.str(), start, Position{line, column});
+                return make_token(TokenType::ILLEGAL, src.substr(st, current - st), start, here());
             }
-            sb << advance();
-            std::string lex = src.substr(st, (current)-st);
-            return make_token(TokenType::STRING, lex, start, Position{line, column});
+            advance();
+            std::string_view lex = src.substr(st, current - st);
+            return make_token(TokenType::STRING, lex, start, here());
         }
         else
         {
@@ -553,55 +617,43 @@ namespace lex
                 char ch = advance();
                 if (ch == '\\')
                 {
-
-                    sb << '\\';
                     if (is_at_end())
                     {
                         emit_error("unterminated escape in string");
                         break;
                     }
-                    char esc = advance();
-                    sb << esc;
+                    advance();
                     continue;
                 }
                 if (ch == '"')
                 {
 
-                    std::string lex = src.substr(st, current - st);
-                    return make_token(TokenType::STRING, lex, start, Position{line, column});
+                    std::string_view lex = src.substr(st, current - st);
+                    return make_token(TokenType::STRING, lex, start, here());
                 }
-                sb << ch;
             }
             emit_error("unterminated string literal");
-            return make_token(TokenType::ILLEGAL, sb.str(), start, Position{line, column});
+            return make_token(TokenType::ILLEGAL, src.substr(st, current - st), start, here());
         }
     }
 
     Token Lexer::char_literal(Position start)
     {
         size_t st = current - 1;
-        std::ostringstream sb;
-        sb << '\'';
         if (is_at_end())
         {
             emit_error("unterminated char literal");
-            return make_token(TokenType::ILLEGAL, "'", start, Position{line, column});
+            return make_token(TokenType::ILLEGAL, src.substr(st, 1), start, here());
         }
         char ch = advance();
         if (ch == '\\')
         {
-            sb << '\\';
             if (is_at_end())
             {
                 emit_error("unterminated char escape");
-                return make_token(TokenType::ILLEGAL, sb.str(), start, Position{line, column});
+                return make_token(TokenType::ILLEGAL, src.substr(st, current - st), start, here());
             }
-            char esc = advance();
-            sb << esc;
-        }
-        else
-        {
-            sb << ch;
+            advance();
         }
         if (peek_char() != '\'')
         {
@@ -613,10 +665,9 @@ namespace lex
         if (peek_char() == '\'')
         {
             advance();
-            sb << '\'';
         }
-        std::string lex = src.substr(st, current - st);
-        return make_token(TokenType::CHAR, lex, start, Position{line, column});
+        std::string_view lex = src.substr(st, current - st);
+        return make_token(TokenType::CHAR, lex, start, here());
     }
 
     bool Lexer::is_ident_start(char c) const
@@ -630,17 +681,21 @@ namespace lex
 
     Token Lexer::peek(int k)
     {
-
-        Lexer copy = *this;
-        Token t;
-        for (int i = 0; i < k; i++)
-            t = copy.next_token();
-        return t;
+        if (k < 1)
+            k = 1;
+        while (lookahead.size() < static_cast<size_t>(k))
+        {
+            if (!lookahead.empty() && lookahead.back().type == TokenType::EOF_TOKEN)
+                return lookahead.back();
+            lookahead.push_back(lex_token());
+        }
+        return lookahead[k - 1];
     }
 
     std::vector<Token> Lexer::tokenize_all()
     {
         std::vector<Token> out;
+        out.reserve(src.size() / 4 + 1);
         for (;;)
         {
             Token t = next_token();
@@ -651,4 +706,18 @@ namespace lex
         return out;
     }
 
+    TokenBuffer Lexer::tokenize_buffer()
+    {
+        TokenBuffer out(src);
+        out.reserve(src.size() / 4 + 1);
+        for (;;)
+        {
+            Token t = next_token();
+            out.push(t.type, static_cast<uint32_t>(t.lexeme.data() - src.data()), static_cast<uint32_t>(t.lexeme.size()));
+            if (t.type == TokenType::EOF_TOKEN)
+                break;
+        }
+        return out;
+    }
+
 }
@@ -1,8 +1,11 @@
 
 #pragma once
 #include "token.h"
+#include "token_buffer.h"
 #include <string>
+#include <string_view>
 #include <functional>
+#include <deque>
 #include <vector>
 
 namespace lex
@@ -10,7 +13,8 @@ namespace lex
     class Lexer
     {
     public:
-        Lexer(const std::string &src, std::function<void(int, int, const std::string &)> error_cb = nullptr);
+        // src is not copied: it must outlive the lexer and every token it returns.
+        Lexer(std::string_view src, std::function<void(int, int, const std::string &)> error_cb = nullptr);
 
         Token next_token();
 
@@ -18,26 +22,35 @@ namespace lex
 
         std::vector<Token> tokenize_all();
 
+        // Lexes the whole source into compact structure-of-arrays storage.
+        TokenBuffer tokenize_buffer();
+
     private:
-        std::string src;
+        std::string_view src;
         size_t current = 0;
         int line = 1;
-        int column = 1;
+        // Offset of the first byte of the current line; the column is derived
+        // from it instead of being tracked on every character.
+        size_t line_start = 0;
         Position last_pos{};
+        // Tokens already scanned by peek() but not yet returned by next_token().
+        std::deque<Token> lookahead;
         std::function<void(int, int, const std::string &)> error_cb;
 
         bool is_at_end() const;
+        Position here() const;
         char advance();
         char peek_char(size_t ahead = 0) const;
         char peek_nonspace_char(size_t ahead = 0) const;
         bool match(char expected);
         void emit_error(const std::string &msg);
 
-        Token make_token(TokenType type, const std::string &lexeme, Position start, Position end);
-        Token make_token_single(TokenType type, const std::string &lexeme, Position start);
+        Token make_token(TokenType type, std::string_view lexeme, Position start, Position end);
+        Token make_token_single(TokenType type, std::string_view lexeme, Position start);
 
-        void skip_whitespace_and_comments(std::vector<Token> &out, bool emit_newline);
+        bool skip_whitespace_and_comments(Token *first_newline);
         Token scan_token();
+        Token lex_token();
 
         Token identifier_or_keyword(Position start);
         Token number_literal(Position start);
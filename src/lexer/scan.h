@@ -0,0 +1,137 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Bulk scanners for the lexer's hot loops. Each one returns the index of the
+// first byte at or after `i` that stops the run, or `n` at end of input. The
+// vector paths look at 32 (AVX2) or 16 (SSE2) bytes per step; the scalar loop
+// handles the tail and targets without either instruction set.
+namespace lex::scan
+{
+    inline bool is_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    inline bool is_ident_part(char c)
+    {
+        unsigned char u = static_cast<unsigned char>(c);
+        return static_cast<unsigned char>((u | 0x20) - 'a') < 26 || static_cast<unsigned char>(u - '0') < 10 || c == '_';
+    }
+
+#if defined(__AVX2__)
+    inline unsigned space_mask(__m256i v)
+    {
+        __m256i m = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+        return static_cast<unsigned>(_mm256_movemask_epi8(m));
+    }
+
+    // Bytes in [lo, lo + len) are mapped onto [-128, -128 + len) so one
+    // signed compare tests the range.
+    inline __m256i in_range(__m256i v, char lo, int len)
+    {
+        __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8(static_cast<char>(0x80 - lo)));
+        return _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(0x80 + len)), shifted);
+    }
+
+    inline unsigned ident_mask(__m256i v)
+    {
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i m = _mm256_or_si256(
+            _mm256_or_si256(in_range(lower, 'a', 26), in_range(v, '0', 10)),
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+        return static_cast<unsigned>(_mm256_movemask_epi8(m));
+    }
+#elif defined(__SSE2__)
+    inline unsigned space_mask(__m128i v)
+    {
+        __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+        return static_cast<unsigned>(_mm_movemask_epi8(m));
+    }
+
+    inline __m128i in_range(__m128i v, char lo, int len)
+    {
+        __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(0x80 - lo)));
+        return _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(0x80 + len)));
+    }
+
+    inline unsigned ident_mask(__m128i v)
+    {
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i m = _mm_or_si128(
+            _mm_or_si128(in_range(lower, 'a', 26), in_range(v, '0', 10)),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+        return static_cast<unsigned>(_mm_movemask_epi8(m));
+    }
+#endif
+
+    // Skips ' ', '\t', '\r' and '\n'.
+    inline size_t skip_space(const char *p, size_t i, size_t n)
+    {
+#if defined(__AVX2__)
+        while (i + 32 <= n)
+        {
+            unsigned stop = ~space_mask(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i)));
+            if (stop)
+                return i + __builtin_ctz(stop);
+            i += 32;
+        }
+#elif defined(__SSE2__)
+        while (i + 16 <= n)
+        {
+            unsigned stop = ~space_mask(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i))) & 0xFFFFu;
+            if (stop)
+                return i + __builtin_ctz(stop);
+            i += 16;
+        }
+#endif
+        while (i < n && is_space(p[i]))
+            ++i;
+        return i;
+    }
+
+    // Skips [A-Za-z0-9_].
+    inline size_t skip_ident(const char *p, size_t i, size_t n)
+    {
+#if defined(__AVX2__)
+        while (i + 32 <= n)
+        {
+            unsigned stop = ~ident_mask(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i)));
+            if (stop)
+                return i + __builtin_ctz(stop);
+            i += 32;
+        }
+#elif defined(__SSE2__)
+        while (i + 16 <= n)
+        {
+            unsigned stop = ~ident_mask(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i))) & 0xFFFFu;
+            if (stop)
+                return i + __builtin_ctz(stop);
+            i += 16;
+        }
+#endif
+        while (i < n && is_ident_part(p[i]))
+            ++i;
+        return i;
+    }
+
+    // Finds the next '\n'. libc's memchr is already vectorized on every
+    // platform we build for, so it doubles as the scalar fallback.
+    inline size_t find_newline(const char *p, size_t i, size_t n)
+    {
+        if (i >= n)
+            return n;
+        const void *hit = std::memchr(p + i, '\n', n - i);
+        return hit ? static_cast<size_t>(static_cast<const char *>(hit) - p) : n;
+    }
+}
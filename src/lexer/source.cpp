@@ -0,0 +1,82 @@
+#include "source.h"
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ECPL_HAVE_MMAP 1
+#endif
+
+namespace lex
+{
+    std::shared_ptr<SourceBuffer> SourceBuffer::open(const std::filesystem::path &path)
+    {
+        std::shared_ptr<SourceBuffer> buf(new SourceBuffer());
+        buf->path_ = path;
+
+#ifdef ECPL_HAVE_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return nullptr;
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            ::close(fd);
+            return nullptr;
+        }
+
+        if (st.st_size > 0)
+        {
+            void *p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                ::close(fd);
+                buf->data_ = static_cast<const char *>(p);
+                buf->size_ = static_cast<size_t>(st.st_size);
+                buf->mapped_ = true;
+                return buf;
+            }
+        }
+        ::close(fd);
+        if (st.st_size == 0)
+            return buf;
+#endif
+
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return nullptr;
+        in.seekg(0, std::ios::end);
+        std::streamoff len = in.tellg();
+        in.seekg(0, std::ios::beg);
+        if (len > 0)
+        {
+            buf->owned_.resize(static_cast<size_t>(len));
+            in.read(buf->owned_.data(), len);
+            buf->owned_.resize(static_cast<size_t>(in.gcount()));
+        }
+        buf->data_ = buf->owned_.data();
+        buf->size_ = buf->owned_.size();
+        return buf;
+    }
+
+    std::shared_ptr<SourceBuffer> SourceBuffer::from_string(std::string text, const std::filesystem::path &path)
+    {
+        std::shared_ptr<SourceBuffer> buf(new SourceBuffer());
+        buf->path_ = path;
+        buf->owned_ = std::move(text);
+        buf->data_ = buf->owned_.data();
+        buf->size_ = buf->owned_.size();
+        return buf;
+    }
+
+    SourceBuffer::~SourceBuffer()
+    {
+#ifdef ECPL_HAVE_MMAP
+        if (mapped_)
+            ::munmap(const_cast<char *>(data_), size_);
+#endif
+    }
+}
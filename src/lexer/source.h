@@ -0,0 +1,37 @@
+#pragma once
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace lex
+{
+    // Read-only view of one source file. Files are memory-mapped where the
+    // platform allows it and read into an owned string otherwise, so the lexer
+    // and every token can point straight into the buffer without copying.
+    class SourceBuffer
+    {
+    public:
+        static std::shared_ptr<SourceBuffer> open(const std::filesystem::path &path);
+        static std::shared_ptr<SourceBuffer> from_string(std::string text, const std::filesystem::path &path = {});
+
+        SourceBuffer(const SourceBuffer &) = delete;
+        SourceBuffer &operator=(const SourceBuffer &) = delete;
+        ~SourceBuffer();
+
+        std::string_view view() const { return {data_, size_}; }
+        const char *data() const { return data_; }
+        size_t size() const { return size_; }
+        const std::filesystem::path &path() const { return path_; }
+        bool is_mapped() const { return mapped_; }
+
+    private:
+        SourceBuffer() = default;
+
+        std::filesystem::path path_;
+        std::string owned_;
+        const char *data_ = "";
+        size_t size_ = 0;
+        bool mapped_ = false;
+    };
+}
@@ -1,12 +1,14 @@
 // Lexer/token.h
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <iostream>
 
 namespace lex
 {
-    enum class TokenType
+    enum class TokenType : uint8_t
     {
         // special
         ILLEGAL,
@@ -118,7 +120,9 @@ namespace lex
     struct Token
     {
         TokenType type = TokenType::ILLEGAL;
-        std::string lexeme;
+        // Points into the SourceBuffer the token was lexed from (or at a
+        // string literal); it is only valid while that buffer is alive.
+        std::string_view lexeme;
         Position start;
         Position end;
     };
@@ -0,0 +1,95 @@
+#pragma once
+#include "token.h"
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace lex
+{
+    // A token as the parser consumes it. Kind and lexeme are read straight
+    // out of a TokenBuffer; the line/column is only resolved from `offset`
+    // when a diagnostic actually needs it.
+    struct TokenRef
+    {
+        TokenType type = TokenType::ILLEGAL;
+        std::string_view lexeme;
+        uint32_t offset = 0;
+    };
+
+    // Structure-of-arrays token storage. Each token costs 9 bytes (kind,
+    // source offset, length) instead of a full Token, and positions are
+    // computed on demand from a line-offset table built on first use.
+    class TokenBuffer
+    {
+    public:
+        TokenBuffer() = default;
+        explicit TokenBuffer(std::string_view src) : src_(src) {}
+
+        void reserve(size_t n)
+        {
+            kinds_.reserve(n);
+            offsets_.reserve(n);
+            lengths_.reserve(n);
+        }
+
+        void push(TokenType type, uint32_t offset, uint32_t length)
+        {
+            kinds_.push_back(type);
+            offsets_.push_back(offset);
+            lengths_.push_back(length);
+        }
+
+        size_t size() const { return kinds_.size(); }
+        bool empty() const { return kinds_.empty(); }
+        std::string_view source() const { return src_; }
+
+        TokenType kind(size_t i) const { return kinds_[i]; }
+        uint32_t offset(size_t i) const { return offsets_[i]; }
+        std::string_view lexeme(size_t i) const { return src_.substr(offsets_[i], lengths_[i]); }
+
+        TokenRef ref(size_t i) const { return TokenRef{kinds_[i], lexeme(i), offsets_[i]}; }
+
+        Position position_of(uint32_t offset) const
+        {
+            if (line_starts_.empty())
+                build_line_table();
+            auto it = std::upper_bound(line_starts_.begin(), line_starts_.end(), offset);
+            size_t line = static_cast<size_t>(it - line_starts_.begin());
+            Position p;
+            p.line = static_cast<int>(line);
+            p.column = static_cast<int>(offset - line_starts_[line - 1]) + 1;
+            return p;
+        }
+
+        Position start(size_t i) const { return position_of(offsets_[i]); }
+        Position end(size_t i) const { return position_of(offsets_[i] + lengths_[i]); }
+
+        Token token(size_t i) const
+        {
+            Token t;
+            t.type = kinds_[i];
+            t.lexeme = lexeme(i);
+            t.start = start(i);
+            t.end = end(i);
+            return t;
+        }
+
+    private:
+        std::string_view src_;
+        std::vector<TokenType> kinds_;
+        std::vector<uint32_t> offsets_;
+        std::vector<uint32_t> lengths_;
+        mutable std::vector<uint32_t> line_starts_;
+
+        void build_line_table() const
+        {
+            line_starts_.push_back(0);
+            for (size_t i = 0; i < src_.size(); ++i)
+            {
+                if (src_[i] == '\n')
+                    line_starts_.push_back(static_cast<uint32_t>(i + 1));
+            }
+        }
+    };
+}
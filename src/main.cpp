@@ -1,5 +1,6 @@
 
 #include "lexer/lexer.h"
+#include "lexer/source.h"
 #include "parser/parser.h"
 #include "ast/printer.h"
 #include "codegen/codegen.h"
@@ -64,20 +65,17 @@ int main(int argc, char *argv[])
     }
 
     std::unique_ptr<ast::Program> merged = std::make_unique<ast::Program>();
-    std::vector<std::unique_ptr<ast::Decl>> struct_decls;
-    std::vector<std::unique_ptr<ast::Decl>> other_decls;
+    std::vector<ast::Ptr<ast::Decl>> struct_decls;
+    std::vector<ast::Ptr<ast::Decl>> other_decls;
 
     for (const auto &p : src_files)
     {
-        std::ifstream in(p);
-        if (!in)
+        auto source = SourceBuffer::open(p);
+        if (!source)
         {
             std::cerr << "Failed to open: " << p << "\n";
             return 1;
         }
-        std::stringstream buf;
-        buf << in.rdbuf();
-        std::string source = buf.str();
 
         auto lex_err = [&p](int line, int col, const std::string &msg)
         {
@@ -88,7 +86,7 @@ int main(int argc, char *argv[])
             std::cerr << "[parser error] " << p << ":" << line << ":" << col << " " << msg << "\n";
         };
 
-        Lexer lx(source, lex_err);
+        Lexer lx(source->view(), lex_err);
 
         Parser parser(lx, parse_err);
         auto file_prog = parser.parse_program();
@@ -98,9 +96,10 @@ int main(int argc, char *argv[])
             return 1;
         }
 
+        merged->adopt(*file_prog);
         for (auto &d : file_prog->decls)
         {
-            if (dynamic_cast<ast::StructDecl *>(d.get()))
+            if (d->kind == ast::NodeKind::StructDecl)
             {
                 struct_decls.push_back(std::move(d));
             }
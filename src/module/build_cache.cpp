@@ -0,0 +1,208 @@
+#include "build_cache.h"
+#include "json.h"
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/SHA1.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace module
+{
+    namespace
+    {
+        std::string read_file(const std::filesystem::path &path)
+        {
+            std::ifstream in(path, std::ios::binary);
+            std::ostringstream contents;
+            contents << in.rdbuf();
+            return contents.str();
+        }
+
+        std::string json_quote(const std::string &s)
+        {
+            std::string out = "\"";
+            for (char c : s)
+            {
+                if (c == '"' || c == '\\')
+                    out += '\\';
+                out += c;
+            }
+            return out + "\"";
+        }
+    }
+
+    BuildCache::BuildCache(std::filesystem::path dir, std::string stamp)
+        : dir_(std::move(dir)), stamp_(std::move(stamp))
+    {
+    }
+
+    std::string BuildCache::hash(std::string_view data)
+    {
+        llvm::SHA1 h;
+        h.update(llvm::StringRef(data.data(), data.size()));
+        return llvm::toHex(h.final(), true);
+    }
+
+    std::string BuildCache::hash_file(const std::filesystem::path &file)
+    {
+        return hash(read_file(file));
+    }
+
+    void BuildCache::scan(const std::vector<std::filesystem::path> &sources)
+    {
+        std::unordered_map<std::string, std::string> previous;
+        if (auto manifest = load_json_file(manifest_path().string()))
+        {
+            previous_build_key_ = manifest->value("build", std::string());
+            if (auto files = manifest->get("files"); files && files->is_object())
+            {
+                for (const auto &[path, h] : files->as_object())
+                {
+                    if (h.is_string())
+                        previous.emplace(path, h.as_string());
+                }
+            }
+            if (auto outputs = manifest->get("outputs"); outputs && outputs->is_array())
+            {
+                for (const auto &o : outputs->as_array())
+                {
+                    if (o.is_string())
+                        previous_outputs_.emplace_back(o.as_string());
+                }
+            }
+        }
+
+        for (const auto &src : sources)
+        {
+            std::string h = hash_file(src);
+            auto it = previous.find(src.string());
+            if (it != previous.end() && it->second == h)
+                ++hits_;
+            else
+                ++misses_;
+            hashes_[src.string()] = std::move(h);
+        }
+
+        // Imports that resolved outside the source directories are not in
+        // `sources`; editing or deleting one must still change the key.
+        for (const auto &[path, h] : previous)
+        {
+            if (!hashes_.count(path))
+                hashes_[path] = std::filesystem::exists(path) ? hash(read_file(path)) : std::string();
+        }
+        update_build_key();
+    }
+
+    void BuildCache::set_files(const std::vector<std::filesystem::path> &files)
+    {
+        std::unordered_map<std::string, std::string> hashes;
+        for (const auto &file : files)
+        {
+            auto it = hashes_.find(file.string());
+            hashes[file.string()] = it != hashes_.end() ? std::move(it->second) : hash(read_file(file));
+        }
+        hashes_ = std::move(hashes);
+        update_build_key();
+    }
+
+    void BuildCache::update_build_key()
+    {
+        std::vector<std::string> entries;
+        for (const auto &[path, h] : hashes_)
+            entries.push_back(path + "\n" + h);
+
+        // Sorted, so the key does not depend on directory iteration order.
+        std::sort(entries.begin(), entries.end());
+        std::string all = stamp_;
+        for (const auto &e : entries)
+            all += "\n" + e;
+        build_key_ = hash(all);
+    }
+
+    bool BuildCache::up_to_date() const
+    {
+        if (build_key_.empty() || build_key_ != previous_build_key_ || previous_outputs_.empty())
+            return false;
+        for (const auto &o : previous_outputs_)
+        {
+            if (!std::filesystem::exists(o))
+                return false;
+        }
+        return true;
+    }
+
+    const std::string &BuildCache::file_hash(const std::filesystem::path &file) const
+    {
+        static const std::string none;
+        auto it = hashes_.find(file.string());
+        return it == hashes_.end() ? none : it->second;
+    }
+
+    std::string BuildCache::module_key(const std::filesystem::path &file, std::vector<std::string> interfaces) const
+    {
+        std::sort(interfaces.begin(), interfaces.end());
+
+        std::string all = stamp_ + "\n" + file_hash(file);
+        for (const auto &d : interfaces)
+            all += "\n" + d;
+        return hash(all);
+    }
+
+    std::optional<std::filesystem::path> BuildCache::find_object(const std::string &key) const
+    {
+        std::filesystem::path path = dir_ / (key + ".o");
+        if (std::filesystem::exists(path))
+            return path;
+        return std::nullopt;
+    }
+
+    bool BuildCache::store_object(const std::string &key, const std::filesystem::path &object)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(dir_, ec);
+        std::filesystem::path tmp = dir_ / (key + ".o.tmp");
+        std::filesystem::copy_file(object, tmp, std::filesystem::copy_options::overwrite_existing, ec);
+        if (ec)
+            return false;
+        std::filesystem::rename(tmp, dir_ / (key + ".o"), ec);
+        return !ec;
+    }
+
+    bool BuildCache::save() const
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(dir_, ec);
+
+        std::ostringstream out;
+        out << "{\n  \"build\": " << json_quote(build_key_) << ",\n  \"files\": {";
+        bool first = true;
+        for (const auto &[path, h] : hashes_)
+        {
+            out << (first ? "\n" : ",\n") << "    " << json_quote(path) << ": " << json_quote(h);
+            first = false;
+        }
+        out << "\n  },\n  \"outputs\": [";
+        first = true;
+        for (const auto &o : outputs_)
+        {
+            out << (first ? "\n" : ",\n") << "    " << json_quote(o.string());
+            first = false;
+        }
+        out << "\n  ]\n}\n";
+
+        // Written beside the manifest and renamed over it, like the objects,
+        // so an interrupted build never leaves a truncated manifest.
+        std::filesystem::path tmp = manifest_path();
+        tmp += ".tmp";
+        {
+            std::ofstream file(tmp, std::ios::binary);
+            file << out.str();
+            file.close();
+            if (!file)
+                return false;
+        }
+        std::filesystem::rename(tmp, manifest_path(), ec);
+        return !ec;
+    }
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace module
+{
+
+    // What the last `ecc build` of a project saw, kept in
+    // <output_dir>/.ecpl-build: the content hash of every source, the
+    // outputs it wrote, and compiled module objects named by a key over a
+    // module's source and everything it imports.
+    class BuildCache
+    {
+    public:
+        // `stamp` covers everything besides the sources that changes the
+        // outputs: the compiler build and the command-line options.
+        BuildCache(std::filesystem::path dir, std::string stamp);
+
+        // Reads the previous state and hashes the current sources. Sources
+        // whose hash matches count as hits, the rest as misses. Files the
+        // previous build resolved from outside `sources` are hashed too.
+        void scan(const std::vector<std::filesystem::path> &sources);
+
+        // Every file the build resolved, imports from outside the source
+        // directories included. Call once resolution is done; the manifest
+        // then lists exactly these files.
+        void set_files(const std::vector<std::filesystem::path> &files);
+
+        // No source changed, none was added or removed, the options are the
+        // same, and every recorded output is still on disk.
+        bool up_to_date() const;
+
+        const std::string &file_hash(const std::filesystem::path &file) const;
+
+        // Key for a module object: its own source plus the interface hash of
+        // every module whose declarations its unit receives, so editing only
+        // the bodies of another module keeps the key.
+        std::string module_key(const std::filesystem::path &file, std::vector<std::string> interfaces) const;
+
+        std::optional<std::filesystem::path> find_object(const std::string &key) const;
+        bool store_object(const std::string &key, const std::filesystem::path &object);
+
+        void set_outputs(std::vector<std::filesystem::path> outputs) { outputs_ = std::move(outputs); }
+        bool save() const;
+
+        size_t hits() const { return hits_; }
+        size_t misses() const { return misses_; }
+        void count_hit() { ++hits_; }
+        void count_miss() { ++misses_; }
+        void reset_counts() { hits_ = misses_ = 0; }
+
+        static std::string hash(std::string_view data);
+        static std::string hash_file(const std::filesystem::path &file);
+
+    private:
+        std::filesystem::path dir_;
+        std::string stamp_;
+        std::unordered_map<std::string, std::string> hashes_;
+        std::string build_key_;
+        std::string previous_build_key_;
+        std::vector<std::filesystem::path> outputs_;
+        std::vector<std::filesystem::path> previous_outputs_;
+        size_t hits_ = 0;
+        size_t misses_ = 0;
+
+        void update_build_key();
+        std::filesystem::path manifest_path() const { return dir_ / "manifest.json"; }
+    };
+
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace module
+{
+
+    // Identifies the compiler build: a hash of every compiler source plus
+    // the LLVM version, generated by cmake/compiler_id.cmake whenever one of
+    // them changes. Anything cached across runs keys on it.
+    const char *compiler_id();
+
+}
@@ -0,0 +1,38 @@
+#include "interface.h"
+
+namespace module
+{
+
+    std::unique_ptr<ast::Program> make_interface(ast::Program &program)
+    {
+        auto iface = std::make_unique<ast::Program>();
+        ast::Arena &arena = program.arena();
+        iface->adopt(program);
+
+        for (const auto &decl : program.decls)
+        {
+            switch (decl->kind)
+            {
+            case ast::NodeKind::PackageDecl:
+            case ast::NodeKind::ImportDecl:
+            case ast::NodeKind::StructDecl:
+                iface->decls.push_back(decl);
+                break;
+            case ast::NodeKind::FuncDecl:
+            {
+                auto fn = static_cast<const ast::FuncDecl *>(decl.get());
+                if (!fn->is_pub)
+                    break;
+                ast::List<ast::Param> params(fn->params, &arena);
+                iface->decls.push_back(ast::Ptr<ast::Decl>(
+                    arena.make<ast::FuncDecl>(fn->name, std::move(params), fn->ret_type, true, nullptr, fn->receiver_name)));
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        return iface;
+    }
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "../ast/ast.h"
+#include <memory>
+
+namespace module
+{
+
+    // What the rest of a project sees of one module: its header and imports,
+    // every struct it declares (units share all structs so their layouts
+    // agree), and the signatures of its pub functions. Bodies and private
+    // functions are left out, so the interface only changes when that
+    // surface does. Stored with ast::write_binary.
+    //
+    // The result shares `program`'s arenas and allocates the body-less
+    // function declarations in them.
+    std::unique_ptr<ast::Program> make_interface(ast::Program &program);
+
+}
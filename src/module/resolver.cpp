@@ -1,7 +1,14 @@
 #include "resolver.h"
+#include "build_cache.h"
+#include "compiler_id.h"
+#include "interface.h"
 #include "json.h"
+#include "thread_pool.h"
 #include "../lexer/lexer.h"
+#include "../lexer/source.h"
 #include "../parser/parser.h"
+#include "../ast/serialize.h"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -77,15 +84,163 @@ namespace module
         source_dirs_.push_back(dir);
     }
 
+    namespace
+    {
+        struct ParsedFile
+        {
+            std::unique_ptr<ast::Program> program;
+            std::vector<std::string> diagnostics;
+            bool cached = false;
+            bool summary_only = false;
+            std::string interface_hash;
+        };
+
+        struct ParseOptions
+        {
+            std::filesystem::path ast;
+            std::filesystem::path interfaces;
+            bool summaries_only = false;
+            bool lazy_bodies = false;
+        };
+
+        // The temporary name is per source file, since two files with the
+        // same text share a key.
+        void store(const std::filesystem::path &dest, const std::string &data, const std::filesystem::path &file)
+        {
+            std::error_code ec;
+            std::filesystem::create_directories(dest.parent_path(), ec);
+            std::filesystem::path tmp = dest.string() + "." + std::to_string(std::hash<std::string>()(file.string()));
+            {
+                std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+                out.write(data.data(), static_cast<std::streamsize>(data.size()));
+                if (!out)
+                {
+                    out.close();
+                    std::filesystem::remove(tmp, ec);
+                    return;
+                }
+            }
+            std::filesystem::rename(tmp, dest, ec);
+        }
+
+        // Touches nothing but its own result, so several files can be parsed
+        // at once. Diagnostics are collected rather than reported so they can
+        // be replayed in input order.
+        ParsedFile parse_source(const std::filesystem::path &file, const ParseOptions &opts)
+        {
+            ParsedFile out;
+            auto source = lex::SourceBuffer::open(file);
+            if (!source)
+            {
+                out.diagnostics.push_back("Failed to open file: " + file.string());
+                return out;
+            }
+
+            // The compiler ID changes with any parser or serializer edit, so
+            // a stale tree is never loaded even if binary_version was not
+            // bumped.
+            std::string key;
+            if (!opts.ast.empty() || !opts.interfaces.empty())
+                key = BuildCache::hash(std::string(compiler_id()) + "\n" + BuildCache::hash(source->view()));
+
+            std::filesystem::path interface_path;
+            if (!opts.interfaces.empty())
+            {
+                interface_path = opts.interfaces / (key + ".ecpi");
+                if (opts.summaries_only)
+                {
+                    auto data = lex::SourceBuffer::open(interface_path);
+                    if (data && (out.program = ast::read_binary(data->view())))
+                    {
+                        out.summary_only = true;
+                        out.interface_hash = BuildCache::hash(data->view());
+                        return out;
+                    }
+                }
+            }
+
+            std::filesystem::path ast_path;
+            if (!opts.ast.empty())
+            {
+                ast_path = opts.ast / (key + ".ast");
+                out.program = ast::load_binary(ast_path);
+                out.cached = out.program != nullptr;
+            }
+
+            if (!out.program)
+            {
+                auto lex_err = [&out, &file](int line, int col, const std::string &msg)
+                {
+                    out.diagnostics.push_back("[lexer] " + file.string() + ":" + std::to_string(line) + ":" + std::to_string(col) + " " + msg);
+                };
+
+                auto parse_err = [&out, &file](int line, int col, const std::string &msg)
+                {
+                    out.diagnostics.push_back("[parser] " + file.string() + ":" + std::to_string(line) + ":" + std::to_string(col) + " " + msg);
+                };
+
+                lex::Lexer lx(source->view(), lex_err);
+                path::Parser parser(lx, parse_err);
+                if (opts.lazy_bodies)
+                {
+                    // Skipped bodies are parsed during codegen; their errors
+                    // stay on the program for the driver to report.
+                    parser.set_lazy_bodies(source, [file](int line, int col, const std::string &msg)
+                                           { return "[parser] " + file.string() + ":" + std::to_string(line) + ":" + std::to_string(col) + " " + msg; });
+                }
+                out.program = parser.parse_program();
+
+                // The parser recovers and always returns a program, so any
+                // diagnostic means the file failed.
+                if (!out.diagnostics.empty())
+                {
+                    out.program.reset();
+                    out.diagnostics.push_back("Failed to parse: " + file.string());
+                }
+
+                // Only clean, complete parses are stored, so a cached file
+                // never hides its diagnostics; writing a lazy parse would
+                // parse every body.
+                if (!ast_path.empty() && !opts.lazy_bodies && out.program && out.diagnostics.empty())
+                    store(ast_path, ast::write_binary(*out.program), file);
+            }
+
+            if (!interface_path.empty() && out.program && out.diagnostics.empty())
+            {
+                std::string data = ast::write_binary(*make_interface(*out.program));
+                out.interface_hash = BuildCache::hash(data);
+                if (!std::filesystem::exists(interface_path))
+                    store(interface_path, data, file);
+            }
+            return out;
+        }
+    }
+
     bool ModuleResolver::resolve_all(const std::vector<std::filesystem::path> &sources)
     {
-        for (const auto &file : sources)
+        std::vector<ParsedFile> parsed(sources.size());
+        ThreadPool pool(std::min<size_t>(jobs_, sources.size()));
+        pool.run(sources.size(), [&](size_t i)
+                 { parsed[i] = parse_source(sources[i], {ast_cache_, interface_cache_, summaries_only_, lazy_bodies_}); });
+
+        // Every file's diagnostics are reported before giving up.
+        bool failed = false;
+        for (size_t i = 0; i < sources.size(); ++i)
         {
-            if (!parse_file(file))
+            for (const auto &msg : parsed[i].diagnostics)
+                emit_error(msg);
+            if (!parsed[i].program)
+                failed = true;
+            if (failed)
+                continue;
+            ast_cache_hits_ += parsed[i].cached;
+            if (!add_module(sources[i], std::move(parsed[i].program), std::move(parsed[i].interface_hash), parsed[i].summary_only))
             {
                 return false;
             }
         }
+        if (failed)
+            return false;
 
         for (auto &pair : modules_)
         {
@@ -102,45 +257,52 @@ namespace module
 
     bool ModuleResolver::parse_file(const std::filesystem::path &file)
     {
-        std::ifstream in(file);
-        if (!in.is_open())
-        {
-            emit_error("Failed to open file: " + file.string());
+        ParsedFile parsed = parse_source(file, {ast_cache_, interface_cache_, summaries_only_, lazy_bodies_});
+        for (const auto &msg : parsed.diagnostics)
+            emit_error(msg);
+        if (!parsed.program)
             return false;
-        }
-
-        std::stringstream buf;
-        buf << in.rdbuf();
-        std::string source = buf.str();
-
-        auto lex_err = [this, &file](int line, int col, const std::string &msg)
-        {
-            emit_error("[lexer] " + file.string() + ":" + std::to_string(line) + ":" + std::to_string(col) + " " + msg);
-        };
-
-        auto parse_err = [this, &file](int line, int col, const std::string &msg)
-        {
-            emit_error("[parser] " + file.string() + ":" + std::to_string(line) + ":" + std::to_string(col) + " " + msg);
-        };
-
-        lex::Lexer lx(source, lex_err);
-        path::Parser parser(lx, parse_err);
-        auto program = parser.parse_program();
+        ast_cache_hits_ += parsed.cached;
+        return add_module(file, std::move(parsed.program), std::move(parsed.interface_hash), parsed.summary_only);
+    }
 
-        if (!program)
-        {
-            emit_error("Failed to parse: " + file.string());
+    bool ModuleResolver::load_body(const std::string &module_name)
+    {
+        auto it = modules_.find(module_name);
+        if (it == modules_.end())
             return false;
-        }
+        ModuleInfo &info = it->second;
+        if (!info.summary_only)
+            return true;
+
+        ParsedFile parsed = parse_source(info.file_path, {ast_cache_, interface_cache_, false, lazy_bodies_});
+        for (const auto &msg : parsed.diagnostics)
+            emit_error(msg);
+        if (!parsed.program)
+            return false;
+        --summary_modules_;
+        ast_cache_hits_ += parsed.cached;
+        info.program = std::move(parsed.program);
+        info.summary_only = false;
+        info.exported_symbols.clear();
+        extract_exports(info);
+        return true;
+    }
 
+    bool ModuleResolver::add_module(const std::filesystem::path &file, std::unique_ptr<ast::Program> program,
+                                    std::string interface_hash, bool summary_only)
+    {
         ModuleInfo info;
         info.file_path = file;
         info.program = std::move(program);
+        info.interface_hash = std::move(interface_hash);
+        info.summary_only = summary_only;
+        summary_modules_ += summary_only;
 
         std::string module_name = file.stem().string();
         for (auto &decl : info.program->decls)
         {
-            if (auto mod_decl = dynamic_cast<ast::ModuleDecl *>(decl.get()))
+            if (auto mod_decl = ast::as<ast::ModuleDecl>(decl.get()))
             {
                 module_name = mod_decl->name;
                 break;
@@ -152,9 +314,9 @@ namespace module
 
         for (auto &decl : info.program->decls)
         {
-            if (auto import_decl = dynamic_cast<ast::ImportDecl *>(decl.get()))
+            if (auto import_decl = ast::as<ast::ImportDecl>(decl.get()))
             {
-                info.imports.push_back(import_decl->path);
+                info.imports.emplace_back(import_decl->path);
             }
         }
 
@@ -166,30 +328,30 @@ namespace module
     {
         for (auto &decl : info.program->decls)
         {
-            if (auto fn = dynamic_cast<ast::FuncDecl *>(decl.get()))
+            if (auto fn = ast::as<ast::FuncDecl>(decl.get()))
             {
                 if (fn->is_pub)
                 {
                     SymbolInfo sym;
-                    sym.name = fn->name;
+                    sym.name = fn->name.str();
                     sym.module_path = info.module_name;
                     sym.is_public = true;
                     sym.is_function = true;
                     sym.decl = fn;
-                    info.exported_symbols[fn->name] = sym;
+                    info.exported_symbols[sym.name] = sym;
                 }
             }
-            else if (auto st = dynamic_cast<ast::StructDecl *>(decl.get()))
+            else if (auto st = ast::as<ast::StructDecl>(decl.get()))
             {
                 if (st->is_pub)
                 {
                     SymbolInfo sym;
-                    sym.name = st->name;
+                    sym.name = st->name.str();
                     sym.module_path = info.module_name;
                     sym.is_public = true;
                     sym.is_struct = true;
                     sym.decl = st;
-                    info.exported_symbols[st->name] = sym;
+                    info.exported_symbols[sym.name] = sym;
                 }
             }
         }
@@ -266,35 +428,26 @@ namespace module
     {
         auto merged = std::make_unique<ast::Program>();
 
-        std::vector<std::unique_ptr<ast::Decl>> struct_decls;
-        std::vector<std::unique_ptr<ast::Decl>> func_decls;
+        std::vector<ast::Ptr<ast::Decl>> struct_decls;
+        std::vector<ast::Ptr<ast::Decl>> func_decls;
 
         for (auto &pair : modules_)
         {
+            merged->adopt(*pair.second.program);
             for (auto &decl : pair.second.program->decls)
             {
-                if (dynamic_cast<ast::ImportDecl *>(decl.get()))
-                {
-                    continue;
-                }
-
-                if (dynamic_cast<ast::ModuleDecl *>(decl.get()))
-                {
-                    continue;
-                }
-
-                if (dynamic_cast<ast::StmtDecl *>(decl.get()))
-                {
-                    continue;
-                }
-
-                if (dynamic_cast<ast::StructDecl *>(decl.get()))
+                switch (decl->kind)
                 {
+                case ast::NodeKind::StructDecl:
                     struct_decls.push_back(std::move(decl));
-                }
-                else if (dynamic_cast<ast::FuncDecl *>(decl.get()))
-                {
+                    break;
+                case ast::NodeKind::FuncDecl:
                     func_decls.push_back(std::move(decl));
+                    break;
+                default:
+                    // imports, the module header and top-level statements
+                    // do not survive linking
+                    break;
                 }
             }
         }
@@ -307,6 +460,51 @@ namespace module
         return merged;
     }
 
+    std::vector<ModuleUnit> ModuleResolver::link_units()
+    {
+        std::vector<const ModuleInfo *> sorted;
+        for (const auto &pair : modules_)
+            sorted.push_back(&pair.second);
+        std::sort(sorted.begin(), sorted.end(), [](const ModuleInfo *a, const ModuleInfo *b)
+                  { return a->module_name < b->module_name; });
+
+        std::vector<ast::Ptr<ast::Decl>> struct_decls;
+        for (const ModuleInfo *info : sorted)
+            for (const auto &decl : info->program->decls)
+                if (decl->kind == ast::NodeKind::StructDecl)
+                    struct_decls.push_back(decl);
+
+        std::vector<ModuleUnit> units;
+        for (const ModuleInfo *info : sorted)
+        {
+            ModuleUnit unit;
+            unit.module_name = info->module_name;
+            unit.file_path = info->file_path;
+            unit.program = std::make_unique<ast::Program>();
+            for (const ModuleInfo *other : sorted)
+                unit.program->adopt(*other->program);
+
+            unit.program->decls = struct_decls;
+            for (const auto &decl : info->program->decls)
+                if (decl->kind == ast::NodeKind::FuncDecl)
+                    unit.program->decls.push_back(decl);
+
+            for (const ModuleInfo *other : sorted)
+            {
+                if (other == info)
+                    continue;
+                for (const auto &decl : other->program->decls)
+                {
+                    auto fn = ast::as<ast::FuncDecl>(decl.get());
+                    if (fn && fn->is_pub)
+                        unit.externs.push_back(fn);
+                }
+            }
+            units.push_back(std::move(unit));
+        }
+        return units;
+    }
+
     const SymbolInfo *ModuleResolver::resolve_symbol(const std::string &name, const std::string &from_module)
     {
         auto it = modules_.find(from_module);
@@ -331,6 +529,16 @@ namespace module
         return nullptr;
     }
 
+    std::vector<std::string> ModuleResolver::unit_inputs(const std::string &module_name) const
+    {
+        std::vector<std::string> names;
+        for (const auto &pair : modules_)
+            if (pair.first != module_name)
+                names.push_back(pair.first);
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
     void ModuleResolver::emit_error(const std::string &msg)
     {
         errors_.push_back(msg);
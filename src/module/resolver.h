@@ -41,6 +41,22 @@ namespace module
         std::unique_ptr<ast::Program> program;
         std::unordered_map<std::string, SymbolInfo> exported_symbols;
         std::vector<std::string> imports;
+        // Hash of the module's interface (see interface.h); empty unless an
+        // interface cache is set.
+        std::string interface_hash;
+        // `program` holds only the interface; see load_body.
+        bool summary_only = false;
+    };
+
+    // One module's share of a split build: every struct in the project (so
+    // types agree across units) plus the module's own functions, with the
+    // public functions of the other modules listed as externs to declare.
+    struct ModuleUnit
+    {
+        std::string module_name;
+        std::filesystem::path file_path;
+        std::unique_ptr<ast::Program> program;
+        std::vector<const ast::FuncDecl *> externs;
     };
 
     class ModuleResolver
@@ -50,13 +66,46 @@ namespace module
 
         void set_project_root(const std::filesystem::path &root);
         void add_source_dir(const std::filesystem::path &dir);
+        void set_jobs(unsigned jobs) { jobs_ = jobs ? jobs : 1; }
+
+        // Parsed files are stored in `dir` under a hash of their text and
+        // loaded from there instead of being parsed again.
+        void set_ast_cache(const std::filesystem::path &dir) { ast_cache_ = dir; }
+        size_t ast_cache_hits() const { return ast_cache_hits_; }
+
+        // Each module's interface is stored in `dir` and its hash recorded.
+        // With `summaries_only`, a module whose interface is already stored
+        // is loaded from it without parsing; call load_body before linking
+        // it into anything that generates its code.
+        void set_interface_cache(const std::filesystem::path &dir, bool summaries_only)
+        {
+            interface_cache_ = dir;
+            summaries_only_ = summaries_only;
+        }
+        bool load_body(const std::string &module_name);
+
+        // Function bodies are skipped while parsing and parsed when code
+        // generation first reaches them (see path::Parser::set_lazy_bodies).
+        void set_lazy_bodies(bool lazy) { lazy_bodies_ = lazy; }
+        // Modules still known only by their interface.
+        size_t summary_modules() const { return summary_modules_; }
 
         bool resolve_all(const std::vector<std::filesystem::path> &sources);
 
         std::unique_ptr<ast::Program> link_program();
 
+        // Units come back sorted by module name. Call instead of
+        // link_program, not after it.
+        std::vector<ModuleUnit> link_units();
+
         const SymbolInfo *resolve_symbol(const std::string &name, const std::string &from_module);
 
+        // The modules whose declarations link_units hands `module_name`'s
+        // unit, sorted by name: every other module, since each unit gets all
+        // structs and every pub function whether it imports them or not. An
+        // object built for the unit stays valid while their interfaces do.
+        std::vector<std::string> unit_inputs(const std::string &module_name) const;
+
         const std::unordered_map<std::string, ModuleInfo> &get_modules() const { return modules_; }
 
         bool has_errors() const { return !errors_.empty(); }
@@ -68,8 +117,17 @@ namespace module
         std::unordered_map<std::string, ModuleInfo> modules_;
         std::unordered_map<std::string, std::string> file_to_module_;
         std::vector<std::string> errors_;
+        unsigned jobs_ = 1;
+        std::filesystem::path ast_cache_;
+        size_t ast_cache_hits_ = 0;
+        std::filesystem::path interface_cache_;
+        bool summaries_only_ = false;
+        bool lazy_bodies_ = false;
+        size_t summary_modules_ = 0;
 
         bool parse_file(const std::filesystem::path &file);
+        bool add_module(const std::filesystem::path &file, std::unique_ptr<ast::Program> program,
+                        std::string interface_hash = {}, bool summary_only = false);
         void extract_exports(ModuleInfo &info);
         bool resolve_imports();
         std::filesystem::path resolve_import_path(const std::string &import_path, const std::filesystem::path &from_file);
@@ -0,0 +1,87 @@
+#include "thread_pool.h"
+
+namespace module
+{
+
+    ThreadPool::ThreadPool(unsigned jobs)
+    {
+        for (unsigned i = 1; i < jobs; ++i)
+            workers_.emplace_back([this]
+                                  { worker_loop(); });
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto &t : workers_)
+            t.join();
+    }
+
+    unsigned ThreadPool::default_jobs()
+    {
+        unsigned n = std::thread::hardware_concurrency();
+        return n ? n : 1;
+    }
+
+    void ThreadPool::run(size_t n, const std::function<void(size_t)> &fn)
+    {
+        if (n == 0)
+            return;
+
+        if (workers_.empty() || n == 1)
+        {
+            for (size_t i = 0; i < n; ++i)
+                fn(i);
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mu_);
+        fn_ = &fn;
+        next_ = 0;
+        count_ = n;
+        finished_ = 0;
+        ++generation_;
+        wake_.notify_all();
+
+        drain(lock);
+        done_.wait(lock, [this]
+                   { return finished_ == count_; });
+        fn_ = nullptr;
+    }
+
+    // Claims indices until none are left. Called with the lock held; the
+    // lock is released around each call into user code.
+    void ThreadPool::drain(std::unique_lock<std::mutex> &lock)
+    {
+        while (fn_ && next_ < count_)
+        {
+            size_t i = next_++;
+            const auto *fn = fn_;
+            lock.unlock();
+            (*fn)(i);
+            lock.lock();
+            if (++finished_ == count_)
+                done_.notify_all();
+        }
+    }
+
+    void ThreadPool::worker_loop()
+    {
+        unsigned seen = 0;
+        std::unique_lock<std::mutex> lock(mu_);
+        for (;;)
+        {
+            wake_.wait(lock, [&]
+                       { return stop_ || generation_ != seen; });
+            if (stop_)
+                return;
+            seen = generation_;
+            drain(lock);
+        }
+    }
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace module
+{
+
+    // Fixed set of worker threads for the driver's embarrassingly parallel
+    // phases (parsing files, later compiling modules). Work is handed out as
+    // an index range; callers write results into per-index slots and consume
+    // them in index order, so output never depends on scheduling.
+    class ThreadPool
+    {
+    public:
+        // `jobs` counts the calling thread, so 1 means no extra threads.
+        explicit ThreadPool(unsigned jobs);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        unsigned jobs() const { return static_cast<unsigned>(workers_.size()) + 1; }
+
+        // Calls fn(i) for every i in [0, n) and returns once all calls have
+        // finished. The calling thread takes part.
+        void run(size_t n, const std::function<void(size_t)> &fn);
+
+        static unsigned default_jobs();
+
+    private:
+        std::vector<std::thread> workers_;
+        std::mutex mu_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+
+        const std::function<void(size_t)> *fn_ = nullptr;
+        size_t next_ = 0;
+        size_t count_ = 0;
+        size_t finished_ = 0;
+        unsigned generation_ = 0;
+        bool stop_ = false;
+
+        void worker_loop();
+        void drain(std::unique_lock<std::mutex> &lock);
+    };
+
+}
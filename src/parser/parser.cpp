@@ -3,8 +3,10 @@
 #include <sstream>
 #include <cctype>
 #include <memory>
+#include <mutex>
+#include <utility>
 
-static std::string decode_string_literal_content(const std::string &lexeme)
+static std::string decode_string_literal_content(std::string_view lexeme)
 {
     if (lexeme.size() < 2)
         return "";
@@ -85,15 +87,86 @@ namespace path
     using namespace lex;
 
     Parser::Parser(Lexer &lx, std::function<void(int, int, const std::string &)> error_cb_)
-        : lexer(lx), error_cb(error_cb_)
+        : Parser(lx.tokenize_buffer(), error_cb_)
     {
-        cur = lexer.next_token();
+    }
+
+    Parser::Parser(TokenBuffer toks, std::function<void(int, int, const std::string &)> error_cb_)
+        : tokens(std::move(toks)), error_cb(error_cb_)
+    {
+        cur = tokens.ref(0);
+    }
+
+    // Owns the tokens of a lazily parsed file and parses its skipped bodies
+    // with a parser of its own, one at a time. Bodies are parsed on whatever
+    // thread generates their code, so errors are kept until the driver asks.
+    class DeferredParser : public ast::DeferredBodies
+    {
+    public:
+        void attach(TokenBuffer toks, ast::Arena *arena, std::shared_ptr<const void> source,
+                    std::function<std::string(int, int, const std::string &)> format)
+        {
+            source_ = std::move(source);
+            auto keep_error = [this, format](int line, int col, const std::string &msg)
+            {
+                ++body_errors_;
+                errors_.push_back(format ? format(line, col, msg)
+                                         : std::to_string(line) + ":" + std::to_string(col) + " " + msg);
+            };
+            parser_ = std::make_unique<Parser>(std::move(toks), keep_error);
+            parser_->arena = arena;
+        }
+
+        BlockStmt *load_body(const ast::FuncDecl &fn) override
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            // Another thread may have parsed it while this one waited.
+            if (!fn.deferred.load(std::memory_order_relaxed))
+                return fn.body.get();
+
+            Ptr<BlockStmt> body;
+            if (parser_)
+            {
+                parser_->pos = fn.body_token;
+                parser_->cur = parser_->tokens.ref(fn.body_token);
+                body_errors_ = 0;
+                body = parser_->parse_block();
+                if (body_errors_)
+                    body = nullptr;
+            }
+            fn.body = std::move(body);
+            fn.deferred.store(nullptr, std::memory_order_release);
+            return fn.body.get();
+        }
+
+        std::vector<std::string> take_errors() override
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            return std::exchange(errors_, {});
+        }
+
+    private:
+        std::mutex mu_;
+        std::unique_ptr<Parser> parser_;
+        std::shared_ptr<const void> source_;
+        size_t body_errors_ = 0;
+        std::vector<std::string> errors_;
+    };
+
+    void Parser::set_lazy_bodies(std::shared_ptr<const void> source,
+                                 std::function<std::string(int, int, const std::string &)> format_error)
+    {
+        lazy = true;
+        lazy_source = std::move(source);
+        format_late_error = std::move(format_error);
     }
 
     void Parser::advance()
     {
         prev = cur;
-        cur = lexer.next_token();
+        if (pos + 1 < tokens.size())
+            ++pos;
+        cur = tokens.ref(pos);
     }
 
     bool Parser::check(TokenType t) const
@@ -111,27 +184,28 @@ namespace path
         return false;
     }
 
-    Token Parser::expect(TokenType t, const std::string &msg)
+    TokenRef Parser::expect(TokenType t, const char *msg)
     {
         if (check(t))
         {
-            Token got = cur;
+            TokenRef got = cur;
             advance();
             return got;
         }
         emit_error(cur, msg);
-        return Token{t, "", cur.start, cur.end};
+        return TokenRef{t, {}, cur.offset};
     }
 
-    void Parser::emit_error(const Token &at, const std::string &msg)
+    void Parser::emit_error(const TokenRef &at, const char *msg)
     {
+        Position p = tokens.position_of(at.offset);
         if (error_cb)
         {
-            error_cb(at.start.line, at.start.column, msg);
+            error_cb(p.line, p.column, msg);
         }
         else
         {
-            std::cerr << "[parser error] " << at.start.line << ":" << at.start.column << " " << msg << "\n";
+            std::cerr << "[parser error] " << p.line << ":" << p.column << " " << msg << "\n";
         }
     }
 
@@ -140,9 +214,17 @@ namespace path
         return cur.type == TokenType::EOF_TOKEN;
     }
 
-    Token Parser::peek_next()
+    TokenRef Parser::peek(size_t k) const
     {
-        return lexer.peek(1);
+        size_t idx = pos + k;
+        if (idx >= tokens.size())
+            idx = tokens.size() - 1;
+        return tokens.ref(idx);
+    }
+
+    TokenRef Parser::peek_next() const
+    {
+        return peek(1);
     }
 
     void Parser::skip_newlines()
@@ -155,6 +237,12 @@ namespace path
     std::unique_ptr<Program> Parser::parse_program()
     {
         auto prog = std::make_unique<Program>();
+        arena = &prog->arena();
+        if (lazy)
+        {
+            deferred = std::make_shared<DeferredParser>();
+            prog->deferred.push_back(deferred);
+        }
 
         while (!is_at_end())
         {
@@ -181,10 +269,14 @@ namespace path
                 prog->decls.push_back(std::move(d));
             skip_newlines();
         }
+
+        // The tokens move to the deferred parser; this one is done.
+        if (deferred && skipped)
+            deferred->attach(std::move(tokens), arena, std::move(lazy_source), std::move(format_late_error));
         return prog;
     }
 
-    std::unique_ptr<Decl> Parser::parse_decl()
+    Ptr<Decl> Parser::parse_decl()
     {
         bool is_pub = false;
         if (check(TokenType::KW_PUB))
@@ -206,12 +298,12 @@ namespace path
         auto stmt = parse_stmt();
         if (stmt)
         {
-            return std::make_unique<StmtDecl>(std::move(stmt));
+            return make<StmtDecl>(std::move(stmt));
         }
         return nullptr;
     }
 
-    std::unique_ptr<Decl> Parser::parse_module_decl()
+    Ptr<Decl> Parser::parse_module_decl()
     {
         if (check(TokenType::KW_MODULE))
             advance();
@@ -224,32 +316,32 @@ namespace path
         }
 
         std::string full;
-        Token t = expect(TokenType::IDENT, "expected module/package name");
+        TokenRef t = expect(TokenType::IDENT, "expected module/package name");
         full = t.lexeme;
         while (match(TokenType::DOT))
         {
-            Token part = expect(TokenType::IDENT, "expected identifier in module/package name");
+            TokenRef part = expect(TokenType::IDENT, "expected identifier in module/package name");
             full += ".";
             full += part.lexeme;
         }
 
         match(TokenType::NEWLINE);
 
-        return std::make_unique<ModuleDecl>(full);
+        return make<ModuleDecl>(str(full));
     }
 
-    std::unique_ptr<Decl> Parser::parse_import_decl()
+    Ptr<Decl> Parser::parse_import_decl()
     {
         expect(TokenType::KW_IMPORT, "expected 'import'");
 
         std::string full;
-        std::vector<std::string> parts;
+        auto parts = list<std::string_view>();
 
         if (check(TokenType::STRING))
         {
-            Token strTk = cur;
+            TokenRef strTk = cur;
             advance();
-            std::string raw = strTk.lexeme;
+            std::string raw(strTk.lexeme);
             if (raw.size() >= 2 && raw.front() == '"' && raw.back() == '"')
             {
                 full = raw.substr(1, raw.size() - 2);
@@ -262,59 +354,57 @@ namespace path
             size_t pos = full.find('/');
             while (pos != std::string::npos)
             {
-                parts.push_back(full.substr(start, pos - start));
+                parts.push_back(str(std::string_view(full).substr(start, pos - start)));
                 start = pos + 1;
                 pos = full.find('/', start);
             }
-            parts.push_back(full.substr(start));
+            parts.push_back(str(std::string_view(full).substr(start)));
         }
         else
         {
-            Token first = expect(TokenType::IDENT, "expected import path");
+            TokenRef first = expect(TokenType::IDENT, "expected import path");
             full = first.lexeme;
-            parts.push_back(first.lexeme);
+            parts.push_back(str(first.lexeme));
 
             while (match(TokenType::DOT))
             {
-                Token p = expect(TokenType::IDENT, "expected identifier in import path");
+                TokenRef p = expect(TokenType::IDENT, "expected identifier in import path");
                 full += ".";
                 full += p.lexeme;
-                parts.push_back(p.lexeme);
+                parts.push_back(str(p.lexeme));
             }
         }
 
-        std::optional<std::string> alias = std::nullopt;
+        std::optional<std::string_view> alias = std::nullopt;
         if (check(TokenType::KW_AS))
         {
             advance();
-            Token aliasTk = expect(TokenType::IDENT, "expected alias after 'as'");
-            alias = aliasTk.lexeme;
+            TokenRef aliasTk = expect(TokenType::IDENT, "expected alias after 'as'");
+            alias = str(aliasTk.lexeme);
         }
 
         match(TokenType::NEWLINE);
 
-        auto imp = std::make_unique<ImportDecl>(full, alias);
-        imp->path_parts = std::move(parts);
-        return imp;
+        return make<ImportDecl>(str(full), std::move(parts), alias);
     }
 
-    std::unique_ptr<BlockStmt> Parser::parse_block()
+    Ptr<BlockStmt> Parser::parse_block()
     {
         expect(TokenType::LBRACE, "expected '{' to start block");
-        auto blk = std::make_unique<BlockStmt>();
+        auto stmts = list<Ptr<Stmt>>();
         skip_newlines();
         while (!check(TokenType::RBRACE) && !is_at_end())
         {
             auto s = parse_stmt();
             if (s)
-                blk->stmts.push_back(std::move(s));
+                stmts.push_back(std::move(s));
             skip_newlines();
         }
         expect(TokenType::RBRACE, "expected '}' to end block");
-        return blk;
+        return make<BlockStmt>(std::move(stmts));
     }
 
-    std::unique_ptr<Stmt> Parser::parse_stmt()
+    Ptr<Stmt> Parser::parse_stmt()
     {
         skip_newlines();
 
@@ -322,14 +412,14 @@ namespace path
         {
             advance();
             match(TokenType::NEWLINE);
-            return std::make_unique<BreakStmt>();
+            return make<BreakStmt>();
         }
 
         if (check(TokenType::KW_CONTINUE))
         {
             advance();
             match(TokenType::NEWLINE);
-            return std::make_unique<ContinueStmt>();
+            return make<ContinueStmt>();
         }
 
         if (check(TokenType::KW_RETURN))
@@ -337,7 +427,7 @@ namespace path
             advance();
             auto expr = parse_expression();
             match(TokenType::NEWLINE);
-            return std::make_unique<ReturnStmt>(std::move(expr));
+            return make<ReturnStmt>(std::move(expr));
         }
 
         if (check(TokenType::KW_IF))
@@ -345,7 +435,7 @@ namespace path
             advance();
             auto cond = parse_expression();
             auto then_blk = parse_block();
-            std::unique_ptr<BlockStmt> else_blk = nullptr;
+            Ptr<BlockStmt> else_blk = nullptr;
             if (check(TokenType::KW_ELSE))
             {
                 advance();
@@ -356,12 +446,12 @@ namespace path
                 else if (check(TokenType::KW_IF))
                 {
                     auto nested_if = parse_stmt();
-                    auto tempBlock = std::make_unique<BlockStmt>();
-                    tempBlock->stmts.push_back(std::move(nested_if));
-                    else_blk = std::move(tempBlock);
+                    auto stmts = list<Ptr<Stmt>>();
+                    stmts.push_back(std::move(nested_if));
+                    else_blk = make<BlockStmt>(std::move(stmts));
                 }
             }
-            return std::make_unique<IfStmt>(std::move(cond), std::move(then_blk), std::move(else_blk));
+            return make<IfStmt>(std::move(cond), std::move(then_blk), std::move(else_blk));
         }
 
         if (check(TokenType::KW_FOR))
@@ -372,55 +462,55 @@ namespace path
             {
                 advance();
 
-                std::unique_ptr<Stmt> initStmt = nullptr;
+                Ptr<Stmt> initStmt = nullptr;
                 if (!check(TokenType::SEMICOLON))
                 {
 
-                    if (check(TokenType::IDENT) && lexer.peek(1).type == TokenType::COLON)
+                    if (check(TokenType::IDENT) && peek(1).type == TokenType::COLON)
                     {
-                        Token id = cur;
+                        TokenRef id = cur;
                         advance();
                         advance();
-                        std::unique_ptr<ast::Type> annotated_type = parse_type();
+                        Ptr<Type> annotated_type = parse_type();
 
                         if (check(TokenType::ASSIGN) && (cur.lexeme == ":=" || cur.lexeme == "="))
                         {
                             advance();
                             auto rhs = parse_expression();
-                            initStmt = std::make_unique<VarDecl>(id.lexeme, std::move(annotated_type), std::move(rhs));
+                            initStmt = make<VarDecl>(intern(id.lexeme), std::move(annotated_type), std::move(rhs));
                         }
                         else
                         {
                             emit_error(cur, "expected ':=' or '=' after type annotation in for-init");
-                            initStmt = std::make_unique<VarDecl>(id.lexeme, std::move(annotated_type), std::make_unique<Literal>("", TokenType::ILLEGAL));
+                            initStmt = make<VarDecl>(intern(id.lexeme), std::move(annotated_type), make<Literal>("", TokenType::ILLEGAL));
                         }
                     }
 
-                    else if (check(TokenType::IDENT) && lexer.peek(1).type == TokenType::ASSIGN && lexer.peek(1).lexeme == ":=")
+                    else if (check(TokenType::IDENT) && peek(1).type == TokenType::ASSIGN && peek(1).lexeme == ":=")
                     {
-                        Token id = cur;
+                        TokenRef id = cur;
                         advance();
                         advance();
                         auto rhs = parse_expression();
-                        initStmt = std::make_unique<VarDecl>(id.lexeme, std::move(rhs));
+                        initStmt = make<VarDecl>(intern(id.lexeme), std::move(rhs));
                     }
                     else
                     {
 
                         auto e = parse_expression();
-                        initStmt = std::make_unique<ExprStmt>(std::move(e));
+                        initStmt = make<ExprStmt>(std::move(e));
                     }
                 }
                 expect(TokenType::SEMICOLON, "expected ';' after for-init");
 
-                std::unique_ptr<Expr> condExpr = nullptr;
+                Ptr<Expr> condExpr = nullptr;
                 if (!check(TokenType::SEMICOLON))
                 {
                     condExpr = parse_expression();
                 }
                 expect(TokenType::SEMICOLON, "expected ';' after for-cond");
 
-                std::unique_ptr<Expr> postExpr = nullptr;
+                Ptr<Expr> postExpr = nullptr;
                 if (!check(TokenType::RPAREN))
                 {
                     postExpr = parse_expression();
@@ -428,22 +518,22 @@ namespace path
                 expect(TokenType::RPAREN, "expected ')' after for clauses");
 
                 auto body = parse_block();
-                return std::make_unique<ForCStyleStmt>(std::move(initStmt), std::move(condExpr), std::move(postExpr), std::move(body));
+                return make<ForCStyleStmt>(std::move(initStmt), std::move(condExpr), std::move(postExpr), std::move(body));
             }
 
             if (check(TokenType::IDENT))
             {
-                Token id = cur;
+                TokenRef id = cur;
                 advance();
                 expect(TokenType::KW_IN, "expected 'in' in for loop");
                 auto iterable = parse_expression();
                 auto body = parse_block();
-                return std::make_unique<ForInStmt>(id.lexeme, std::move(iterable), std::move(body));
+                return make<ForInStmt>(intern(id.lexeme), std::move(iterable), std::move(body));
             }
             else
             {
                 auto body = parse_block();
-                return std::make_unique<ForStmt>(std::move(body));
+                return make<ForStmt>(std::move(body));
             }
         }
 
@@ -454,22 +544,21 @@ namespace path
 
         auto lhs = parse_expression();
 
-        if (auto ident = dynamic_cast<Ident *>(lhs.get()))
+        if (auto ident = as<Ident>(lhs.get()))
         {
             if (check(TokenType::COLON))
             {
                 advance();
 
-                std::unique_ptr<ast::Type> annotated_type = parse_type();
+                Ptr<Type> annotated_type = parse_type();
 
                 if (check(TokenType::ASSIGN) && (cur.lexeme == ":=" || cur.lexeme == "="))
                 {
-                    Token assignTk = cur;
                     advance();
                     auto rhs = parse_expression();
                     match(TokenType::NEWLINE);
 
-                    return std::make_unique<VarDecl>(ident->name, std::move(annotated_type), std::move(rhs));
+                    return make<VarDecl>(ident->name, std::move(annotated_type), std::move(rhs));
                 }
                 else
                 {
@@ -481,8 +570,8 @@ namespace path
 
         if (check(TokenType::ASSIGN))
         {
-            Token assignTk = cur;
-            std::string op = assignTk.lexeme;
+            TokenRef assignTk = cur;
+            std::string op(assignTk.lexeme);
             advance();
 
             auto rhs = parse_expression();
@@ -490,9 +579,9 @@ namespace path
 
             if (op == ":=")
             {
-                if (auto ident = dynamic_cast<Ident *>(lhs.get()))
+                if (auto ident = as<Ident>(lhs.get()))
                 {
-                    return std::make_unique<VarDecl>(ident->name, std::move(rhs));
+                    return make<VarDecl>(ident->name, std::move(rhs));
                 }
                 else
                 {
@@ -502,141 +591,140 @@ namespace path
             }
             else
             {
-                return std::make_unique<AssignStmt>(std::move(lhs), std::move(rhs));
+                return make<AssignStmt>(std::move(lhs), std::move(rhs));
             }
         }
 
         match(TokenType::NEWLINE);
-        return std::make_unique<ExprStmt>(std::move(lhs));
+        return make<ExprStmt>(std::move(lhs));
     }
 
-    std::unique_ptr<Expr> Parser::parse_expression()
+    Ptr<Expr> Parser::parse_expression()
     {
         return parse_logical_or();
     }
 
-    std::unique_ptr<Expr> Parser::parse_logical_or()
+    Ptr<Expr> Parser::parse_logical_or()
     {
         auto left = parse_logical_and();
         while (check(TokenType::OR))
         {
-            Token op = cur;
+            TokenRef op = cur;
             advance();
             auto right = parse_logical_and();
-            left = std::make_unique<BinaryExpr>(op.lexeme, std::move(left), std::move(right));
+            left = make<BinaryExpr>(str(op.lexeme), std::move(left), std::move(right));
         }
         return left;
     }
 
-    std::unique_ptr<Expr> Parser::parse_logical_and()
+    Ptr<Expr> Parser::parse_logical_and()
     {
         auto left = parse_bitwise_and();
         while (check(TokenType::AND))
         {
-            Token op = cur;
+            TokenRef op = cur;
             advance();
             auto right = parse_bitwise_and();
-            left = std::make_unique<BinaryExpr>(op.lexeme, std::move(left), std::move(right));
+            left = make<BinaryExpr>(str(op.lexeme), std::move(left), std::move(right));
         }
         return left;
     }
-    std::unique_ptr<Expr> Parser::parse_equality()
+    Ptr<Expr> Parser::parse_equality()
     {
         auto left = parse_comparison();
         while (check(TokenType::EQ) || check(TokenType::NEQ))
         {
-            Token op = cur;
+            TokenRef op = cur;
             advance();
             auto right = parse_comparison();
-            left = std::make_unique<BinaryExpr>(op.lexeme, std::move(left), std::move(right));
+            left = make<BinaryExpr>(str(op.lexeme), std::move(left), std::move(right));
         }
         return left;
     }
 
-    std::unique_ptr<Expr> Parser::parse_bitwise_and()
+    Ptr<Expr> Parser::parse_bitwise_and()
     {
 
         auto left = parse_equality();
 
         while (check(TokenType::ADDRESS_OF))
         {
-            Token op = cur;
+            TokenRef op = cur;
             advance();
             auto right = parse_equality();
-            left = std::make_unique<BinaryExpr>(op.lexeme, std::move(left), std::move(right));
+            left = make<BinaryExpr>(str(op.lexeme), std::move(left), std::move(right));
         }
         return left;
     }
 
-    std::unique_ptr<Expr> Parser::parse_comparison()
+    Ptr<Expr> Parser::parse_comparison()
     {
         auto left = parse_shift();
         while (check(TokenType::LT) || check(TokenType::GT) || check(TokenType::LE) || check(TokenType::GE))
         {
-            Token op = cur;
+            TokenRef op = cur;
             advance();
             auto right = parse_shift();
-            left = std::make_unique<BinaryExpr>(op.lexeme, std::move(left), std::move(right));
+            left = make<BinaryExpr>(str(op.lexeme), std::move(left), std::move(right));
         }
         return left;
     }
 
-    std::unique_ptr<Expr> Parser::parse_additive()
+    Ptr<Expr> Parser::parse_additive()
     {
         auto left = parse_multiplicative();
         while (check(TokenType::PLUS) || check(TokenType::MINUS))
         {
-            Token op = cur;
+            TokenRef op = cur;
             advance();
             auto right = parse_multiplicative();
-            left = std::make_unique<BinaryExpr>(op.lexeme, std::move(left), std::move(right));
+            left = make<BinaryExpr>(str(op.lexeme), std::move(left), std::move(right));
         }
         return left;
     }
 
-    std::unique_ptr<Expr> Parser::parse_multiplicative()
+    Ptr<Expr> Parser::parse_multiplicative()
     {
         auto left = parse_unary();
         while (check(TokenType::STAR) || check(TokenType::DEREF) || check(TokenType::SLASH) || check(TokenType::PERCENT))
         {
-            Token op = cur;
+            TokenRef op = cur;
 
             if (op.type == TokenType::DEREF)
                 op.lexeme = "*";
             advance();
             auto right = parse_unary();
-            left = std::make_unique<BinaryExpr>(op.lexeme, std::move(left), std::move(right));
+            left = make<BinaryExpr>(str(op.lexeme), std::move(left), std::move(right));
         }
         return left;
     }
 
-    std::unique_ptr<Expr> Parser::parse_unary()
+    Ptr<Expr> Parser::parse_unary()
     {
 
         if (check(TokenType::BANG) || check(TokenType::MINUS) || check(TokenType::PLUS) ||
             check(TokenType::PLUSPLUS) || check(TokenType::MINUSMINUS) ||
             check(TokenType::DEREF) || check(TokenType::ADDRESS_OF))
         {
-            Token op = cur;
+            TokenRef op = cur;
             advance();
             auto rhs = parse_unary();
 
-            std::string op_lex = op.lexeme;
+            std::string op_lex(op.lexeme);
             if (op.type == TokenType::DEREF)
                 op_lex = "*";
             else if (op.type == TokenType::ADDRESS_OF)
                 op_lex = "&";
 
-            return std::make_unique<UnaryExpr>(op_lex, std::move(rhs));
+            return make<UnaryExpr>(str(op_lex), std::move(rhs));
         }
 
         if (check(TokenType::LBRACK))
         {
 
-            Token t0 = cur;
-            Token next1 = lexer.peek(1);
-            Token next2 = lexer.peek(2);
-            Token next3 = lexer.peek(3);
+            TokenRef next1 = peek(1);
+            TokenRef next2 = peek(2);
+            TokenRef next3 = peek(3);
 
             if (next1.type == TokenType::RBRACK && next2.type == TokenType::IDENT && next3.type == TokenType::LBRACE)
             {
@@ -644,11 +732,11 @@ namespace path
                 advance();
                 advance();
 
-                Token typeTk = expect(TokenType::IDENT, "expected type name after '[]' in typed array literal");
+                TokenRef typeTk = expect(TokenType::IDENT, "expected type name after '[]' in typed array literal");
 
                 expect(TokenType::LBRACE, "expected '{' to start typed array literal");
 
-                std::vector<std::unique_ptr<Expr>> elems;
+                auto elems = list<Ptr<Expr>>();
                 skip_newlines();
                 if (!check(TokenType::RBRACE))
                 {
@@ -676,12 +764,12 @@ namespace path
                 }
                 expect(TokenType::RBRACE, "expected '}' to close typed array literal");
 
-                std::unique_ptr<ast::Type> elemType = std::make_unique<ast::NamedType>(typeTk.lexeme);
-                auto arrType = std::make_unique<ast::ArrayType>(
+                Ptr<Type> elemType = make<NamedType>(intern(typeTk.lexeme));
+                auto arrType = make<ArrayType>(
                     std::move(elemType),
                     true);
 
-                auto node = std::make_unique<ast::ArrayLiteral>(std::move(arrType), std::move(elems));
+                auto node = make<ArrayLiteral>(std::move(arrType), std::move(elems));
                 return parse_postfix(std::move(node));
             }
 
@@ -692,10 +780,10 @@ namespace path
         return parse_primary();
     }
 
-    std::unique_ptr<Expr> Parser::parse_array_literal()
+    Ptr<Expr> Parser::parse_array_literal()
     {
         expect(TokenType::LBRACK, "expected '[' to start array literal");
-        std::vector<std::unique_ptr<Expr>> elems;
+        auto elems = list<Ptr<Expr>>();
 
         skip_newlines();
         if (!check(TokenType::RBRACK))
@@ -724,13 +812,13 @@ namespace path
         }
 
         expect(TokenType::RBRACK, "expected ']' to close array literal");
-        return std::make_unique<ArrayLiteral>(std::move(elems));
+        return make<ArrayLiteral>(std::move(elems));
     }
 
-    std::unique_ptr<Expr> Parser::parse_byte_array_literal()
+    Ptr<Expr> Parser::parse_byte_array_literal()
     {
         expect(TokenType::LBRACK, "expected '[' to start byte array literal");
-        std::vector<std::unique_ptr<Expr>> elems;
+        auto elems = list<Ptr<Expr>>();
 
         skip_newlines();
         if (!check(TokenType::RBRACK))
@@ -759,10 +847,10 @@ namespace path
         }
 
         expect(TokenType::RBRACK, "expected ']' to close byte array literal");
-        return std::make_unique<ast::ByteArrayLiteral>(std::move(elems));
+        return make<ByteArrayLiteral>(std::move(elems));
     }
 
-    std::unique_ptr<Expr> Parser::parse_postfix(std::unique_ptr<Expr> left)
+    Ptr<Expr> Parser::parse_postfix(Ptr<Expr> left)
     {
         while (true)
         {
@@ -771,23 +859,23 @@ namespace path
                 advance();
                 auto idxExpr = parse_expression();
                 expect(TokenType::RBRACK, "expected ']' after index");
-                left = std::make_unique<IndexExpr>(std::move(left), std::move(idxExpr));
+                left = make<IndexExpr>(std::move(left), std::move(idxExpr));
                 continue;
             }
 
             if (check(TokenType::PLUSPLUS) || check(TokenType::MINUSMINUS))
             {
-                Token op = cur;
+                TokenRef op = cur;
                 advance();
-                left = std::make_unique<PostfixExpr>(op.lexeme, std::move(left));
+                left = make<PostfixExpr>(str(op.lexeme), std::move(left));
                 continue;
             }
 
             if (check(TokenType::DOT))
             {
                 advance();
-                Token memberTk = expect(TokenType::IDENT, "expected member name after '.'");
-                left = std::make_unique<MemberExpr>(std::move(left), memberTk.lexeme);
+                TokenRef memberTk = expect(TokenType::IDENT, "expected member name after '.'");
+                left = make<MemberExpr>(std::move(left), intern(memberTk.lexeme));
                 continue;
             }
 
@@ -797,26 +885,26 @@ namespace path
         return left;
     }
 
-    std::unique_ptr<Expr> Parser::parse_shift()
+    Ptr<Expr> Parser::parse_shift()
     {
         auto left = parse_additive();
         while (check(TokenType::SHL) || check(TokenType::SHR))
         {
-            Token op = cur;
+            TokenRef op = cur;
             advance();
             auto right = parse_additive();
-            left = std::make_unique<BinaryExpr>(op.lexeme, std::move(left), std::move(right));
+            left = make<BinaryExpr>(str(op.lexeme), std::move(left), std::move(right));
         }
         return left;
     }
 
-    std::unique_ptr<Expr> Parser::parse_primary()
+    Ptr<Expr> Parser::parse_primary()
     {
         if (check(TokenType::INT) || check(TokenType::FLOAT) || check(TokenType::STRING) || check(TokenType::CHAR))
         {
-            Token tk = cur;
+            TokenRef tk = cur;
             advance();
-            auto lit = std::make_unique<Literal>(tk.lexeme, tk.type);
+            auto lit = make<Literal>(str(tk.lexeme), tk.type);
             return parse_postfix(std::move(lit));
         }
 
@@ -828,15 +916,15 @@ namespace path
 
         if (check(TokenType::IDENT))
         {
-            Token id = cur;
+            TokenRef id = cur;
             advance();
 
-            std::unique_ptr<Expr> result;
+            Ptr<Expr> result;
 
             if (check(TokenType::LPAREN))
             {
                 advance();
-                std::vector<std::unique_ptr<Expr>> args;
+                auto args = list<Ptr<Expr>>();
                 if (!check(TokenType::RPAREN))
                 {
                     while (true)
@@ -848,13 +936,13 @@ namespace path
                     }
                 }
                 expect(TokenType::RPAREN, "expected ')' in call");
-                result = std::make_unique<CallExpr>(std::make_unique<Ident>(id.lexeme), std::move(args));
+                result = make<CallExpr>(make<Ident>(intern(id.lexeme)), std::move(args));
             }
 
             else if (check(TokenType::LBRACE))
             {
                 advance();
-                std::vector<ast::StructFieldInit> inits;
+                auto inits = list<StructFieldInit>();
                 skip_newlines();
                 if (!check(TokenType::RBRACE))
                 {
@@ -864,17 +952,17 @@ namespace path
 
                         if (check(TokenType::IDENT) && peek_next().type == TokenType::COLON)
                         {
-                            Token nameTk = cur;
+                            TokenRef nameTk = cur;
                             advance();
                             expect(TokenType::COLON, "expected ':' in struct field init");
                             auto val = parse_expression();
-                            inits.emplace_back(std::optional<std::string>(nameTk.lexeme), std::move(val));
+                            inits.emplace_back(std::optional<Symbol>(intern(nameTk.lexeme)), std::move(val));
                         }
                         else
                         {
 
                             auto val = parse_expression();
-                            inits.emplace_back(std::optional<std::string>(std::nullopt), std::move(val));
+                            inits.emplace_back(std::optional<Symbol>(std::nullopt), std::move(val));
                         }
 
                         skip_newlines();
@@ -894,12 +982,12 @@ namespace path
                 }
                 expect(TokenType::RBRACE, "expected '}' to close struct literal");
 
-                result = std::make_unique<ast::StructLiteral>(std::make_unique<ast::NamedType>(id.lexeme), std::move(inits));
+                result = make<StructLiteral>(make<NamedType>(intern(id.lexeme)), std::move(inits));
             }
             else
             {
 
-                result = std::make_unique<Ident>(id.lexeme);
+                result = make<Ident>(intern(id.lexeme));
             }
 
             return parse_postfix(std::move(result));
@@ -925,90 +1013,90 @@ namespace path
 
             if (check(TokenType::STRING))
             {
-                Token strTk = cur;
+                TokenRef strTk = cur;
                 advance();
 
                 std::string content = decode_string_literal_content(strTk.lexeme);
-                std::vector<uint8_t> bytes;
-                bytes.reserve(content.size());
+                auto elems = list<Ptr<Expr>>();
+                elems.reserve(content.size());
                 for (unsigned char ch : content)
-                    bytes.push_back(static_cast<uint8_t>(ch));
+                    elems.push_back(make<Literal>(str(std::to_string(static_cast<int>(ch))), TokenType::INT));
 
-                auto node = std::make_unique<ast::ByteArrayLiteral>(bytes);
+                auto node = make<ByteArrayLiteral>(std::move(elems));
                 return parse_postfix(std::move(node));
             }
 
             emit_error(cur, "expected '[' or string literal after 'byte'");
 
-            auto empty = std::make_unique<ast::ByteArrayLiteral>(std::vector<std::unique_ptr<Expr>>{});
+            auto empty = make<ByteArrayLiteral>(list<Ptr<Expr>>());
             return parse_postfix(std::move(empty));
         }
 
         emit_error(cur, "unexpected token in expression");
         advance();
-        return parse_postfix(std::make_unique<Literal>("", TokenType::ILLEGAL));
+        return parse_postfix(make<Literal>("", TokenType::ILLEGAL));
     }
 
-    std::unique_ptr<Decl> Parser::parse_struct_decl(bool is_pub)
+    Ptr<Decl> Parser::parse_struct_decl(bool is_pub)
     {
         expect(TokenType::KW_STRUCT, "expected 'struct'");
-        Token nameTk = expect(TokenType::IDENT, "expected struct name");
-        std::string name = nameTk.lexeme;
+        TokenRef nameTk = expect(TokenType::IDENT, "expected struct name");
+        Symbol name = intern(nameTk.lexeme);
 
         expect(TokenType::LBRACE, "expected '{' after struct name");
 
-        auto sdecl = std::make_unique<ast::StructDecl>(name);
-        sdecl->is_pub = is_pub;
+        auto fields = list<Ptr<StructField>>();
 
         skip_newlines();
         while (!check(TokenType::RBRACE) && !is_at_end())
         {
-            Token fieldNameTk = expect(TokenType::IDENT, "expected field name in struct");
-            std::string fieldName = fieldNameTk.lexeme;
+            TokenRef fieldNameTk = expect(TokenType::IDENT, "expected field name in struct");
 
-            auto field = std::make_shared<ast::StructField>();
-            field->name = fieldName;
+            auto field = make<StructField>();
+            field->name = intern(fieldNameTk.lexeme);
 
             if (check(TokenType::KW_STRUCT))
             {
                 advance();
                 expect(TokenType::LBRACE, "expected '{' for inline struct in field");
-                auto inlineStruct = std::make_shared<ast::StructDecl>("");
+                auto inlineFields = list<Ptr<StructField>>();
                 skip_newlines();
                 while (!check(TokenType::RBRACE) && !is_at_end())
                 {
-                    Token fn = expect(TokenType::IDENT, "expected field name in inline struct");
-                    std::string fnname = fn.lexeme;
+                    TokenRef fn = expect(TokenType::IDENT, "expected field name in inline struct");
+                    Symbol fnname = intern(fn.lexeme);
 
-                    std::unique_ptr<ast::Type> ft = parse_type();
+                    Ptr<Type> ft = parse_type();
 
-                    auto inlineField = std::make_shared<ast::StructField>();
+                    auto inlineField = make<StructField>();
                     inlineField->name = fnname;
                     inlineField->type = std::move(ft);
-                    inlineStruct->fields.push_back(std::move(inlineField));
+                    inlineFields.push_back(std::move(inlineField));
 
                     match(TokenType::NEWLINE);
                     skip_newlines();
                 }
                 expect(TokenType::RBRACE, "expected '}' after inline struct");
-                field->inline_struct = inlineStruct;
+                field->inline_struct = make<StructDecl>(Symbol(), std::move(inlineFields));
             }
             else
             {
                 field->type = parse_type();
             }
 
-            sdecl->fields.push_back(std::move(field));
+            fields.push_back(std::move(field));
 
             match(TokenType::NEWLINE);
             skip_newlines();
         }
 
         expect(TokenType::RBRACE, "expected '}' to close struct");
+        auto sdecl = make<StructDecl>(name, std::move(fields));
+        sdecl->is_pub = is_pub;
         return sdecl;
     }
 
-        std::unique_ptr<ast::Type> Parser::parse_type()
+        Ptr<Type> Parser::parse_type()
     {
 
         std::string ptr_prefix;
@@ -1031,66 +1119,66 @@ namespace path
             advance();
             expect(TokenType::RBRACK, "expected ']' after '[' in array type");
 
-            std::unique_ptr<ast::Type> base;
+            Ptr<Type> base;
             if (check(TokenType::KW_BYTE) || (check(TokenType::IDENT) && cur.lexeme == "byte"))
             {
 
                 advance();
-                base = std::make_unique<ast::NamedType>("byte");
+                base = make<NamedType>(intern("byte"));
             }
             else
             {
-                Token elemTk = expect(TokenType::IDENT, "expected element type after '[]'");
-                base = std::make_unique<ast::NamedType>(elemTk.lexeme);
+                TokenRef elemTk = expect(TokenType::IDENT, "expected element type after '[]'");
+                base = make<NamedType>(intern(elemTk.lexeme));
             }
 
-            std::unique_ptr<ast::Type> arrType = std::make_unique<ast::ArrayType>(std::move(base), true);
+            Ptr<Type> arrType = make<ArrayType>(std::move(base), true);
 
             for (char c : ptr_prefix)
             {
-                arrType = std::make_unique<ast::PointerType>(std::move(arrType));
+                arrType = make<PointerType>(std::move(arrType));
             }
 
             return arrType;
         }
 
-        std::unique_ptr<ast::Type> base;
+        Ptr<Type> base;
         if (check(TokenType::KW_BYTE) || (check(TokenType::IDENT) && cur.lexeme == "byte"))
         {
             advance();
-            base = std::make_unique<ast::NamedType>("byte");
+            base = make<NamedType>(intern("byte"));
         }
         else
         {
-            Token t = expect(TokenType::IDENT, "expected type name");
-            base = std::make_unique<ast::NamedType>(t.lexeme);
+            TokenRef t = expect(TokenType::IDENT, "expected type name");
+            base = make<NamedType>(intern(t.lexeme));
         }
 
         for (char c : ptr_prefix)
         {
-            base = std::make_unique<ast::PointerType>(std::move(base));
+            base = make<PointerType>(std::move(base));
         }
         return base;
     }
 
-    std::unique_ptr<Decl> Parser::parse_function_decl(bool is_pub)
+    Ptr<Decl> Parser::parse_function_decl(bool is_pub)
     {
         expect(TokenType::KW_FN, "expected 'fn'");
 
-        Token firstTk = expect(TokenType::IDENT, "expected function or method name");
-        std::optional<std::string> receiverName;
-        std::string funcName;
+        TokenRef firstTk = expect(TokenType::IDENT, "expected function or method name");
+        std::optional<Symbol> receiverName;
+        Symbol funcName;
 
         if (check(TokenType::DOT))
         {
-            receiverName = firstTk.lexeme;
+            receiverName = intern(firstTk.lexeme);
             advance();
-            Token methodTk = expect(TokenType::IDENT, "expected method name after '.'");
-            funcName = methodTk.lexeme;
+            TokenRef methodTk = expect(TokenType::IDENT, "expected method name after '.'");
+            funcName = intern(methodTk.lexeme);
         }
         else
         {
-            funcName = firstTk.lexeme;
+            funcName = intern(firstTk.lexeme);
         }
 
         expect(TokenType::LPAREN, "expected '(' after fn name");
@@ -1103,7 +1191,7 @@ namespace path
                 return true;
             }
 
-            if (check(TokenType::DOT) && lexer.peek(1).type == TokenType::DOT && lexer.peek(2).type == TokenType::DOT)
+            if (check(TokenType::DOT) && peek(1).type == TokenType::DOT && peek(2).type == TokenType::DOT)
             {
                 advance();
                 advance();
@@ -1113,7 +1201,7 @@ namespace path
             return false;
         };
 
-        std::vector<Param> params;
+        auto params = list<Param>();
         if (!check(TokenType::RPAREN))
         {
             while (true)
@@ -1133,7 +1221,7 @@ namespace path
                     }
                 }
 
-                Token id = expect(TokenType::IDENT, "expected parameter name");
+                TokenRef id = expect(TokenType::IDENT, "expected parameter name");
 
                 bool is_variadic = false;
                 if (consume_ellipsis())
@@ -1141,7 +1229,7 @@ namespace path
                     is_variadic = true;
                 }
 
-                std::unique_ptr<ast::Type> typePtr;
+                Ptr<Type> typePtr;
 
                 if (check(TokenType::LBRACK) || check(TokenType::IDENT) || check(TokenType::KW_BYTE) || check(TokenType::DEREF) || check(TokenType::ADDRESS_OF))
                 {
@@ -1152,26 +1240,26 @@ namespace path
                     if (is_variadic)
                     {
 
-                        typePtr = std::make_unique<ast::NamedType>("any");
+                        typePtr = make<NamedType>(intern("any"));
                     }
                     else if (!prefix_before_name.empty())
                     {
 
-                        std::unique_ptr<ast::Type> base = std::make_unique<ast::NamedType>("int");
+                        Ptr<Type> base = make<NamedType>(intern("int"));
                         for (char c : prefix_before_name)
                         {
-                            base = std::make_unique<ast::PointerType>(std::move(base));
+                            base = make<PointerType>(std::move(base));
                         }
                         typePtr = std::move(base);
                     }
                     else
                     {
                         emit_error(cur, "expected parameter type after name (use: 'name type', e.g. 'x int')");
-                        typePtr = std::make_unique<ast::NamedType>("int");
+                        typePtr = make<NamedType>(intern("int"));
                     }
                 }
 
-                params.push_back(Param{id.lexeme, std::move(typePtr), is_variadic});
+                params.emplace_back(intern(id.lexeme), std::move(typePtr), is_variadic);
 
                 if (is_variadic)
                 {
@@ -1192,14 +1280,38 @@ namespace path
         }
         expect(TokenType::RPAREN, "expected ')' after params");
 
-        std::unique_ptr<ast::Type> ret_type_ptr = nullptr;
+        Ptr<Type> ret_type_ptr = nullptr;
         if (check(TokenType::IDENT) || check(TokenType::LBRACK) || check(TokenType::DEREF) || check(TokenType::ADDRESS_OF) || check(TokenType::KW_BYTE))
         {
             ret_type_ptr = parse_type();
         }
 
+        // A body that does not open with a brace is parsed now, so it gets
+        // the same diagnostics as in an eager parse.
+        if (deferred && check(TokenType::LBRACE))
+        {
+            uint32_t first = static_cast<uint32_t>(pos);
+            size_t depth = 0;
+            do
+            {
+                if (check(TokenType::LBRACE))
+                    ++depth;
+                else if (check(TokenType::RBRACE))
+                    --depth;
+                advance();
+            } while (depth > 0 && !is_at_end());
+            if (depth > 0)
+                emit_error(cur, "expected '}' to end block");
+
+            auto fn = make<FuncDecl>(funcName, std::move(params), std::move(ret_type_ptr), is_pub, nullptr, receiverName);
+            fn->deferred = deferred.get();
+            fn->body_token = first;
+            ++skipped;
+            return fn;
+        }
+
         auto body = parse_block();
-        return std::make_unique<FuncDecl>(funcName, std::move(params), std::move(ret_type_ptr), is_pub, std::move(body), receiverName);
+        return make<FuncDecl>(funcName, std::move(params), std::move(ret_type_ptr), is_pub, std::move(body), receiverName);
     }
 
 }
@@ -11,57 +11,101 @@ namespace path
 {
     using namespace lex;
 
+    class DeferredParser;
+
     class Parser
     {
     public:
         Parser(Lexer &lx, std::function<void(int, int, const std::string &)> error_cb = nullptr);
+        Parser(TokenBuffer toks, std::function<void(int, int, const std::string &)> error_cb = nullptr);
+
+        // Skip function bodies by brace matching and leave each one to be
+        // parsed the first time ast::FuncDecl::get_body asks for it. The
+        // program then keeps the tokens, and `source` keeps alive the text
+        // they point into. Errors in those bodies are collected on the
+        // program (see ast::Program::take_late_errors), each message built
+        // by `format_error`, so it must not capture anything that dies
+        // before the program. parse_program is the last call on a lazy
+        // parser.
+        void set_lazy_bodies(std::shared_ptr<const void> source,
+                             std::function<std::string(int, int, const std::string &)> format_error = nullptr);
 
         std::unique_ptr<ast::Program> parse_program();
 
     private:
-        Lexer &lexer;
-        Token cur;
-        Token prev;
+        friend class DeferredParser;
+
+        // The whole file is tokenized up front so lookahead is a plain index
+        // into this buffer; the last entry is always EOF_TOKEN.
+        TokenBuffer tokens;
+        size_t pos = 0;
+        TokenRef cur;
+        TokenRef prev;
         std::function<void(int, int, const std::string &)> error_cb;
+        // Arena of the program being parsed; every node and name goes here.
+        ast::Arena *arena = nullptr;
+
+        bool lazy = false;
+        std::shared_ptr<const void> lazy_source;
+        std::function<std::string(int, int, const std::string &)> format_late_error;
+        std::shared_ptr<DeferredParser> deferred;
+        size_t skipped = 0;
+
+        template <typename T, typename... Args>
+        ast::Ptr<T> make(Args &&...args)
+        {
+            return ast::Ptr<T>(arena->make<T>(std::forward<Args>(args)...));
+        }
+
+        template <typename T>
+        ast::List<T> list()
+        {
+            return ast::List<T>(arena);
+        }
+
+        std::string_view str(std::string_view s) { return arena->str(s); }
 
         void advance();
         bool check(TokenType t) const;
         bool match(TokenType t);
-        Token expect(TokenType t, const std::string &msg);
-        void emit_error(const Token &at, const std::string &msg);
+        // Messages are string literals, so the expect() fast path never
+        // materializes a std::string.
+        TokenRef expect(TokenType t, const char *msg);
+        void emit_error(const TokenRef &at, const char *msg);
 
         void skip_newlines();
 
-        std::unique_ptr<ast::Decl> parse_decl();
-        std::unique_ptr<ast::Decl> parse_module_decl();
-        std::unique_ptr<ast::Decl> parse_import_decl();
-        std::unique_ptr<ast::Decl> parse_function_decl(bool is_pub);
-        std::unique_ptr<ast::Decl> parse_struct_decl(bool is_pub);
-
-        std::unique_ptr<ast::Stmt> parse_stmt();
-        std::unique_ptr<ast::BlockStmt> parse_block();
-
-        std::unique_ptr<ast::Stmt> parse_var_or_expr_stmt();
-
-        std::unique_ptr<ast::Expr> parse_expression();
-        std::unique_ptr<ast::Expr> parse_assignment();
-        std::unique_ptr<ast::Expr> parse_logical_or();
-        std::unique_ptr<ast::Expr> parse_logical_and();
-        std::unique_ptr<ast::Expr> parse_equality();
-        std::unique_ptr<ast::Expr> parse_comparison();
-        std::unique_ptr<ast::Expr> parse_additive();
-        std::unique_ptr<ast::Expr> parse_multiplicative();
-        std::unique_ptr<ast::Expr> parse_unary();
-        std::unique_ptr<ast::Expr> parse_primary();
-        std::unique_ptr<ast::Expr> parse_array_literal();
-        std::unique_ptr<ast::Expr> parse_byte_array_literal();
-        std::unique_ptr<ast::Expr> parse_postfix(std::unique_ptr<ast::Expr> left);
-        std::unique_ptr<ast::Expr> parse_shift();
-        std::unique_ptr<ast::Expr> parse_bitwise_and();
-        std::unique_ptr<ast::Type> parse_type();
+        ast::Ptr<ast::Decl> parse_decl();
+        ast::Ptr<ast::Decl> parse_module_decl();
+        ast::Ptr<ast::Decl> parse_import_decl();
+        ast::Ptr<ast::Decl> parse_function_decl(bool is_pub);
+        ast::Ptr<ast::Decl> parse_struct_decl(bool is_pub);
+
+        ast::Ptr<ast::Stmt> parse_stmt();
+        ast::Ptr<ast::BlockStmt> parse_block();
+
+        ast::Ptr<ast::Stmt> parse_var_or_expr_stmt();
+
+        ast::Ptr<ast::Expr> parse_expression();
+        ast::Ptr<ast::Expr> parse_assignment();
+        ast::Ptr<ast::Expr> parse_logical_or();
+        ast::Ptr<ast::Expr> parse_logical_and();
+        ast::Ptr<ast::Expr> parse_equality();
+        ast::Ptr<ast::Expr> parse_comparison();
+        ast::Ptr<ast::Expr> parse_additive();
+        ast::Ptr<ast::Expr> parse_multiplicative();
+        ast::Ptr<ast::Expr> parse_unary();
+        ast::Ptr<ast::Expr> parse_primary();
+        ast::Ptr<ast::Expr> parse_array_literal();
+        ast::Ptr<ast::Expr> parse_byte_array_literal();
+        ast::Ptr<ast::Expr> parse_postfix(ast::Ptr<ast::Expr> left);
+        ast::Ptr<ast::Expr> parse_shift();
+        ast::Ptr<ast::Expr> parse_bitwise_and();
+        ast::Ptr<ast::Type> parse_type();
 
         bool is_at_end() const;
-        Token peek_next();
+        TokenRef peek(size_t k = 1) const;
+        TokenRef peek_next() const;
     };
 
 }